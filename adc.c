@@ -0,0 +1,194 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Interrupt driven ADC scan scheduler. Timer0 compare match A starts a conversion every
+			system tick. ADC_vect discards the settling conversions of the current channel, 
+			accumulates 4^n results and publishes the decimated value, then picks the next 
+			channel that is due (round robin) and writes its ADMUX before the next trigger.
+			Readers never wait for a conversion.
+-------------------------------------------------------------------------------------------------**/
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "timer0.h"
+#include "adc.h"
+
+#if ADC_RING_SIZE & (ADC_RING_SIZE - 1)
+	#error ADC_RING_SIZE must be a power of 2.
+#endif
+
+// MUX setting of the internal 1.1V bandgap
+#define ADC_MUX_BANDGAP		0x0e
+
+// Oversampling of the other channels, ADC_OVERSAMPLE_BITS is the MG811 one
+#define ADC_SOIL_OVERSAMPLE		1
+#define ADC_LIGHT_OVERSAMPLE	1
+#define ADC_VCC_OVERSAMPLE		2
+
+/* 4^n conversions are counted in the 8-bit left and summed in the 16-bit acc: 64 conversions
+   of 1023 is the most both hold. */
+#define ADC_OVERSAMPLE_MAX		3
+
+#if ADC_OVERSAMPLE_BITS > ADC_OVERSAMPLE_MAX || ADC_SOIL_OVERSAMPLE > ADC_OVERSAMPLE_MAX || \
+	ADC_LIGHT_OVERSAMPLE > ADC_OVERSAMPLE_MAX || ADC_VCC_OVERSAMPLE > ADC_OVERSAMPLE_MAX
+	#error Oversampling above ADC_OVERSAMPLE_MAX bits overflows the conversion counter and the accumulator.
+#endif
+
+static const adcChannel_Type adcChannels[ADC_CHANNELS] PROGMEM = {
+	// admux						discard	oversample				period
+	{ (1<<REFS0) | 0,				1,		ADC_OVERSAMPLE_BITS,	100 },	// ADC_MG811
+	{ (1<<REFS0) | 1,				1,		ADC_SOIL_OVERSAMPLE,	1000 },	// ADC_SOIL
+	{ (1<<REFS0) | 2,				1,		ADC_LIGHT_OVERSAMPLE,	250 },	// ADC_LIGHT
+	{ (1<<REFS0) | ADC_MUX_BANDGAP,	2,		ADC_VCC_OVERSAMPLE,		1000 },	// ADC_VCC
+};
+
+/* Sample store */
+static volatile uint16_t adcValue[ADC_CHANNELS];
+static volatile uint8_t adcSeq[ADC_CHANNELS];
+static volatile uint16_t adcRing[ADC_RING_SIZE];
+static volatile uint8_t adcHead;
+
+/* Scheduler state, only used by ADC_vect */
+static uint16_t adcDue[ADC_CHANNELS];
+static uint8_t current;
+static uint8_t active;
+static uint8_t skip;
+static uint8_t left;
+static uint8_t shift;
+static uint16_t acc;
+
+/**------------------------------------------------------------------------------------------------
+  Description : 	Initialize ADC in auto trigger mode and start scanning
+-------------------------------------------------------------------------------------------------**/
+void initADC(void)
+{
+	uint8_t i, mux;
+
+	// disable digital function of the pins in the scan list
+	for ( i = 0; i < ADC_CHANNELS; i++ )
+	{
+		mux = pgm_read_byte(&adcChannels[i].admux) & 0x0f;
+		if ( mux < 8 )
+			DIDR0 |= (1<<mux);
+	}
+	current = ADC_CHANNELS - 1;
+	ADMUX = pgm_read_byte(&adcChannels[current].admux);
+	// Trigger source: Timer/Counter0 compare match A
+	ADCSRB = (1<<ADTS1) | (1<<ADTS0);
+	// 128 prescaler => 125 kHz, auto trigger, conversion complete interrupt
+	ADCSRA = (1<<ADEN) | (1<<ADATE) | (1<<ADIE) | (1<<ADPS2) | (1<<ADPS1) | (1<<ADPS0);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Most recent result of a channel
+  Return		: 	0 .. (1024 << oversample) - 1
+-------------------------------------------------------------------------------------------------**/
+uint16_t adcRead(uint8_t channel)
+{
+	uint16_t retval;
+	uint8_t sreg = SREG;
+
+	cli();
+	retval = adcValue[channel];
+	SREG = sreg;
+
+	return retval;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Counter incremented with every result of a channel. Compare two readings to
+					find out if new data is available.
+-------------------------------------------------------------------------------------------------**/
+uint8_t adcSequence(uint8_t channel)
+{
+	return adcSeq[channel];
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Average of the last ADC_RING_SIZE results of ADC_RING_CHANNEL
+-------------------------------------------------------------------------------------------------**/
+uint16_t adcAverage(void)
+{
+	uint32_t sum = 0;
+	uint8_t i;
+	uint8_t sreg = SREG;
+
+	cli();
+	for ( i = 0; i < ADC_RING_SIZE; i++ )
+		sum += adcRing[i];
+	SREG = sreg;
+
+	return sum / ADC_RING_SIZE;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Supply voltage computed from the bandgap reading
+  Return		: 	AVCC in millivolts, 0 before the first reading
+-------------------------------------------------------------------------------------------------**/
+uint16_t adcVcc(void)
+{
+	uint16_t code = adcRead(ADC_VCC);
+	uint8_t bits = pgm_read_byte(&adcChannels[ADC_VCC].oversample);
+
+	if ( !code ) 
+		return 0;
+	return (1100UL * (1024UL << bits)) / code;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Selects the next due channel after the current one. ADMUX is latched at the 
+					start of the next conversion, one tick later.
+-------------------------------------------------------------------------------------------------**/
+static inline void adcNext(void)
+{
+	uint16_t now = (uint16_t)Ticks;
+	uint8_t i, ch = current;
+
+	for ( i = 0; i < ADC_CHANNELS; i++ )
+	{
+		if ( ++ch == ADC_CHANNELS )
+			ch = 0;
+		if ( (int16_t)(now - adcDue[ch]) >= 0 )
+		{
+			adcDue[ch] = now + pgm_read_word(&adcChannels[ch].period);
+			ADMUX = pgm_read_byte(&adcChannels[ch].admux);
+			skip = pgm_read_byte(&adcChannels[ch].discard);
+			shift = pgm_read_byte(&adcChannels[ch].oversample);
+			left = 1 << (2 * shift);
+			acc = 0;
+			current = ch;
+			active = 1;
+			return;
+		}
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Conversion complete - discard, accumulate, decimate, publish, switch channel
+-------------------------------------------------------------------------------------------------**/
+ISR(ADC_vect)
+{
+	uint16_t value = ADC;
+
+	if ( active )
+	{
+		if ( skip )
+		{
+			skip--;
+			return;
+		}
+		acc += value;
+		if ( --left )
+			return;
+
+		value = acc >> shift;
+		adcValue[current] = value;
+		adcSeq[current]++;
+		if ( current == ADC_RING_CHANNEL )
+		{
+			adcHead = (adcHead + 1) & (ADC_RING_SIZE - 1);
+			adcRing[adcHead] = value;
+		}
+		active = 0;
+	}
+	adcNext();
+}
@@ -0,0 +1,44 @@
+#ifndef ADC_H
+#define ADC_H
+
+#include <stdint.h>
+
+/* Conversions are auto-triggered by Timer0 compare match A (one per system tick), so
+   initTimer0() must be called for the ADC to run. ADC_vect scans the channels listed in 
+   adcChannels[] (adc.c) and switches ADMUX itself; the main loop only reads results. */
+
+/* Scan list. Keep in the same order as adcChannels[]. */
+typedef enum {
+	ADC_MG811,			// ADC0 - MG811 CO2 sensor
+	ADC_SOIL,			// ADC1 - soil moisture probe
+	ADC_LIGHT,			// ADC2 - light sensor
+	ADC_VCC,			// internal 1.1V bandgap measured against AVCC
+	ADC_CHANNELS
+} adcChannelId_Type;
+
+typedef struct {
+	uint8_t admux;		// REFSx and MUXx bits
+	uint8_t discard;	// conversions thrown away after switching to the channel (settling)
+	uint8_t oversample;	// extra resolution bits: 4^oversample conversions per result (0..3)
+	uint16_t period;	// ms between two results
+} adcChannel_Type;
+
+/* Oversampling: 4^n conversions are summed and shifted right by n, adding n bits of 
+   resolution to the 10-bit result. It only works if the signal carries at least 1 LSB 
+   of noise. ADC_OVERSAMPLE_BITS is the setting of the MG811 channel. */
+#define ADC_OVERSAMPLE_BITS	2
+#define ADC_RESOLUTION		(10 + ADC_OVERSAMPLE_BITS)
+#define ADC_FULL_SCALE		(1UL << ADC_RESOLUTION)
+
+// Channel whose results are also kept in a ring buffer (see adcAverage)
+#define ADC_RING_CHANNEL	ADC_MG811
+// Number of results kept in the ring buffer. Must be a power of 2.
+#define ADC_RING_SIZE		8
+
+void initADC(void);
+uint16_t adcRead(uint8_t channel);
+uint8_t adcSequence(uint8_t channel);
+uint16_t adcAverage(void);
+uint16_t adcVcc(void);
+
+#endif
@@ -1,37 +1,121 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Backlight PWM, 16 levels. With BACKLIGHT_OC0B (config.h) the pin is the OC0B output
+			of Timer0, which runs fast PWM with TOP = OCR0A for the system tick: the PWM is 
+			TICK_RATE_HZ and costs no interrupt at all. BACKLIGHT_SOFT keeps the original 
+			PORTB.1 wiring, toggled by the Timer2 compare and overflow interrupts. At 16 MHz 
+			these fire 125000 times a second and take 28 cycles each with the usual prologue
+			(vector jump, r0/r1/SREG saved, reti): 3.5 Mcycles/s, 22 % of the CPU, and every
+			other interrupt is delayed by up to 1.75 us.
+			The level is faded through blGamma[] by backlightService() from the main loop, one
+			step per call at most, so its cost does not depend on the fade or the idle time.
+-------------------------------------------------------------------------------------------------**/
 #include <stdint.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "config.h"
 #include "utils.h"
+#include "timer0.h"
 #include "backlight.h"
 
-uint8_t gBacklight;
+#define BL_MAX_STEP		((BACKLIGHT_LEVELS - 1) * BACKLIGHT_STEPS)
 
-void initBacklight(void)
+// Duty cycle in 1/256 of the period for every step: 255 * (step / BL_MAX_STEP) ^ 2.2, at
+// least 1 above step 0. Equal steps of the table look like equal changes of brightness.
+static const uint8_t blGamma[BL_MAX_STEP + 1] PROGMEM = {
+	  0,   1,   1,   1,   1,   1,   2,   2,   3,   4,   5,   6,
+	  7,   9,  10,  12,  14,  16,  18,  20,  23,  25,  28,  31,
+	 34,  37,  41,  44,  48,  52,  55,  60,  64,  68,  73,  78,
+	 83,  88,  93,  99, 105, 110, 116, 123, 129, 135, 142, 149,
+	156, 163, 171, 178, 186, 194, 202, 211, 219, 228, 237, 246,
+	255,
+};
+
+uint8_t gBacklight;					// level set by the user
+
+static uint8_t step;				// step on the output
+static uint8_t target;				// step being faded to
+static uint8_t dimmed;
+static uint32_t lastStep;
+static uint32_t lastKey;
+
+#if (BACKLIGHT == BACKLIGHT_OC0B)
+
+static void blInit(void)
+{
+	cbi(PORTD,5);
+	sbi(DDRD,5);
+}
+
+static void blOutput(uint8_t duty)
+{
+	if(duty > 0) 
+	{
+		// Timer0 period is OCR0A + 1 counts, high from BOTTOM up to the OCR0B match
+		OCR0B = (uint16_t)(OCR0A + 1) * duty >> 8;
+		TCCR0A |= (1<<COM0B1);
+	}
+	else
+	{
+		// OCR0B = 0 would still leave a one count pulse, disconnect the pin instead
+		TCCR0A &= ~((1<<COM0B1) | (1<<COM0B0));
+	}
+}
+
+#else
+
+static void blInit(void)
 {
 	sbi(DDRB,1);
-	sbi(PORTB,1);
+	cbi(PORTB,1);
 	TCCR2A = 0;
 	TCCR2B = 1;
-	TIMSK2 = 3;
-	setBacklight(7);
 }
 
-void setBacklight(uint8_t val)
+static void blOutput(uint8_t duty)
 {
-	if(val > 15) return;
-	if(val > 0) 
+	if(duty > 0) 
 	{
-		if(gBacklight == 0)
-			TIMSK2 = 3;
-		OCR2A = val * 16 - 1;
+		OCR2A = duty;
+		TIMSK2 = 3;
 	}
 	else
 	{
 		TIMSK2 = 0;
 		cbi(PORTB,1);
 	}
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+	cbi(PORTB,1);
+}
+
+ISR(TIMER2_OVF_vect)
+{
+	sbi(PORTB,1);
+}
+
+#endif
+
+void initBacklight(void)
+{
+	blInit();
+	lastKey = getTicks();
+	setBacklight(7);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Sets the level, 0..15. The output fades to it unless the backlight is dimmed,
+					then the level applies when it wakes.
+-------------------------------------------------------------------------------------------------**/
+void setBacklight(uint8_t val)
+{
+	if(val >= BACKLIGHT_LEVELS) return;
 
 	gBacklight = val;
+	if( !dimmed )
+		target = val * BACKLIGHT_STEPS;
 }
 
 uint8_t getBacklight(void)
@@ -41,7 +125,7 @@ uint8_t getBacklight(void)
 
 void incrBacklight(void)
 {
-	if( gBacklight < 15 )
+	if( gBacklight < BACKLIGHT_LEVELS - 1 )
 		setBacklight(gBacklight+1);
 }
 
@@ -51,12 +135,49 @@ void decrBacklight(void)
 		setBacklight(gBacklight-1);
 }
 
-ISR(TIMER2_COMPA_vect)
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Called from the main loop. Dims after BACKLIGHT_IDLE_S without a key and moves
+					the output one step towards the target every BACKLIGHT_FADE_MS.
+-------------------------------------------------------------------------------------------------**/
+void backlightService(void)
 {
-	cbi(PORTB,1);
+	uint32_t now = getTicks();
+
+	if( BACKLIGHT_IDLE_S && !dimmed && now - lastKey >= BACKLIGHT_IDLE_S * 1000UL )
+	{
+		dimmed = 1;
+		if( gBacklight > BACKLIGHT_IDLE_LEVEL )
+			target = BACKLIGHT_IDLE_LEVEL * BACKLIGHT_STEPS;
+	}
+
+	if( step == target || now - lastStep < BACKLIGHT_FADE_MS )
+		return;
+
+	lastStep = now;
+	if( step < target )
+		step++;
+	else
+		step--;
+	blOutput(pgm_read_byte(&blGamma[step]));
 }
 
-ISR(TIMER2_OVF_vect)
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Restarts the idle time, call it for every key. A dimmed backlight goes back to
+					its level at once, without fading.
+  Return		: 	1 if the backlight was dimmed below its level, the key should then only wake it
+-------------------------------------------------------------------------------------------------**/
+uint8_t backlightWake(void)
 {
-	sbi(PORTB,1);
+	uint8_t woke;
+
+	lastKey = getTicks();
+	if( !dimmed )
+		return 0;
+
+	dimmed = 0;
+	target = gBacklight * BACKLIGHT_STEPS;
+	woke = step < target;
+	step = target;
+	blOutput(pgm_read_byte(&blGamma[step]));
+	return woke;
 }
@@ -3,10 +3,24 @@
 
 #include <stdint.h>
 
+/* Backlight with 16 levels (0 = off). Each level is BACKLIGHT_STEPS fine steps of a gamma
+   table, and backlightService() moves the output one step every BACKLIGHT_FADE_MS towards the
+   level, so changes fade in instead of jumping. After BACKLIGHT_IDLE_S without a key the
+   backlight fades down to BACKLIGHT_IDLE_LEVEL; backlightWake() restores it at once. */
+
+#define BACKLIGHT_LEVELS		16
+#define BACKLIGHT_STEPS			4		// gamma table entries per level
+#define BACKLIGHT_FADE_MS		8		// one level in 32 ms, off to full in half a second
+// Idle time before dimming, 0 never dims
+#define BACKLIGHT_IDLE_S		120
+#define BACKLIGHT_IDLE_LEVEL	1
+
 void initBacklight(void);
 void setBacklight(uint8_t val);
 uint8_t getBacklight(void);
 void incrBacklight(void);
 void decrBacklight(void);
+void backlightService(void);
+uint8_t backlightWake(void);
 
 #endif
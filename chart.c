@@ -0,0 +1,224 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Trend chart. Samples are stored as one byte, (value - base) >> shift, in a ring per
+			series (CHART_SERIES * CHART_LEN bytes). Column 0 of the plot is the oldest sample.
+			A new sample normally scrolls the region one column to the left and draws only the
+			new column; the region is redrawn completely when the auto scale has to change.
+-------------------------------------------------------------------------------------------------**/
+#include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "lph7366.h"
+#include "chart.h"
+
+#define CHART_HEIGHT	(CHART_BANKS * 8)
+
+#if CHART_X + CHART_LEN > X_RES || CHART_BANK + CHART_BANKS > LCD_LINES
+	#error Chart region outside of the screen.
+#endif
+
+static const chartConfig_Type chartConfig[CHART_SERIES] PROGMEM = {
+	{ 0,	5,	CHART_LINE },		// CO2, 32 ppm steps up to 8160 ppm
+	{ -200,	2,	CHART_LINE },		// temperature, 0.4 C steps from -20 C
+	{ 0,	2,	CHART_BARS },		// humidity, 0.4 %RH steps
+};
+
+static uint8_t samples[CHART_SERIES][CHART_LEN];
+static uint8_t head[CHART_SERIES];		// oldest sample, next one to overwrite
+static uint8_t visible;
+static uint8_t lo, hi;					// scale of the visible series, quantised
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Quantised sample of the visible series shown in column col
+-------------------------------------------------------------------------------------------------**/
+static uint8_t chartSample(uint8_t col)
+{
+	uint8_t i = head[visible] + col;
+
+	if ( i >= CHART_LEN )
+		i -= CHART_LEN;
+	return samples[visible][i];
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Recomputes the scale of the visible series. The limits are rounded to
+					multiples of 4 steps so small changes do not force a full redraw.
+  Return		: 	1 if the scale changed
+-------------------------------------------------------------------------------------------------**/
+static uint8_t chartScale(void)
+{
+	uint8_t i, q, min = 0xFF, max = 0;
+
+	for ( i = 0; i < CHART_LEN; i++ )
+	{
+		q = samples[visible][i];
+		if ( q == CHART_NODATA )
+			continue;
+		if ( q < min ) min = q;
+		if ( q > max ) max = q;
+	}
+	if ( min > max )
+		min = max = 0;
+
+	min &= ~3;
+	max |= 3;
+	if ( min == lo && max == hi )
+		return 0;
+	lo = min;
+	hi = max;
+	return 1;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Row of a sample in the region, 0 = top
+-------------------------------------------------------------------------------------------------**/
+static uint8_t chartRow(uint8_t q)
+{
+	return (CHART_HEIGHT - 1) - (uint16_t)(q - lo) * (CHART_HEIGHT - 1) / (hi - lo);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Renders one column of the region into LCD.Cache. A line joins the sample
+					to the previous one with a vertical run, bars are filled to the bottom.
+-------------------------------------------------------------------------------------------------**/
+static void chartColumn(uint8_t col)
+{
+	uint8_t *ptr = &LCD.Cache[CHART_BANK * X_RES + CHART_X + col];
+	uint8_t q = chartSample(col);
+	uint8_t top = 0xFF, bottom = 0, prev, b, t, e, mask;
+
+	if ( q != CHART_NODATA )
+	{
+		top = bottom = chartRow(q);
+		if ( pgm_read_byte(&chartConfig[visible].style) == CHART_BARS )
+			bottom = CHART_HEIGHT - 1;
+		else if ( col > 0 && (prev = chartSample(col - 1)) != CHART_NODATA )
+		{
+			prev = chartRow(prev);
+			if ( prev < top ) top = prev;
+			if ( prev > bottom ) bottom = prev;
+		}
+	}
+
+	for ( b = 0; b < CHART_BANKS; b++, ptr += X_RES )
+	{
+		mask = 0;
+		if ( top < b * 8 + 8 && bottom >= b * 8 )
+		{
+			t = ( top > b * 8 ) ? top - b * 8 : 0;
+			e = ( bottom < b * 8 + 7 ) ? bottom - b * 8 : 7;
+			mask = ( 0xFF << t ) & ( 0xFF >> ( 7 - e ) );
+		}
+		*ptr = mask;
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Redraws the whole region
+-------------------------------------------------------------------------------------------------**/
+static void chartDraw(void)
+{
+	uint8_t col, b;
+
+	for ( col = 0; col < CHART_LEN; col++ )
+		chartColumn(col);
+	for ( b = CHART_BANK; b < CHART_BANK + CHART_BANKS; b++ )
+		dDirty(b, CHART_X, CHART_X + CHART_LEN - 1);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Appends a quantised sample and updates the plot if the series is visible
+-------------------------------------------------------------------------------------------------**/
+static void chartStore(uint8_t series, uint8_t q)
+{
+	uint8_t b;
+
+	if ( series >= CHART_SERIES )
+		return;
+
+	samples[series][head[series]] = q;
+	if ( ++head[series] == CHART_LEN )
+		head[series] = 0;
+
+	if ( series != visible )
+		return;
+
+	if ( chartScale() )
+	{
+		chartDraw();
+		return;
+	}
+
+	// Same scale: scroll one column left and draw the new sample only
+	for ( b = CHART_BANK; b < CHART_BANK + CHART_BANKS; b++ )
+	{
+		memmove(&LCD.Cache[b * X_RES + CHART_X], &LCD.Cache[b * X_RES + CHART_X + 1], CHART_LEN - 1);
+		dDirty(b, CHART_X, CHART_X + CHART_LEN - 1);
+	}
+	chartColumn(CHART_LEN - 1);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Clears the history of all series. Does not draw.
+-------------------------------------------------------------------------------------------------**/
+void chartInit(void)
+{
+	memset(samples, CHART_NODATA, sizeof(samples));
+	memset(head, 0, sizeof(head));
+	visible = CHART_CO2;
+	lo = hi = 0;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Adds a sample to a series, clamped to the quantised range
+  Argument(s)	:	series -> chartSeries_Type, value -> in the unit of the series
+-------------------------------------------------------------------------------------------------**/
+void chartPush(uint8_t series, int16_t value)
+{
+	int16_t v;
+
+	if ( series >= CHART_SERIES )
+		return;
+
+	v = value - (int16_t)pgm_read_word(&chartConfig[series].base);
+	if ( v < 0 )
+		v = 0;
+	v >>= pgm_read_byte(&chartConfig[series].shift);
+	if ( v > CHART_NODATA - 1 )
+		v = CHART_NODATA - 1;
+	chartStore(series, (uint8_t)v);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Adds a gap to a series, keeps the time axis of all series aligned
+-------------------------------------------------------------------------------------------------**/
+void chartPushMissing(uint8_t series)
+{
+	chartStore(series, CHART_NODATA);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Selects the series drawn in the chart region and redraws it
+-------------------------------------------------------------------------------------------------**/
+void chartShow(uint8_t series)
+{
+	if ( series >= CHART_SERIES )
+		return;
+	visible = series;
+	chartScale();
+	chartDraw();
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Current scale of the visible series, for labelling the axis
+  Argument(s)	:	low, high -> receive the bottom and top of the plot in the unit of the series
+  Return		: 	visible series
+-------------------------------------------------------------------------------------------------**/
+uint8_t chartRange(int16_t * low, int16_t * high)
+{
+	int16_t base = pgm_read_word(&chartConfig[visible].base);
+	uint8_t shift = pgm_read_byte(&chartConfig[visible].shift);
+
+	*low = base + ((int16_t)lo << shift);
+	*high = base + (((int16_t)hi + 1) << shift) - 1;
+	return visible;
+}
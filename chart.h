@@ -0,0 +1,45 @@
+#ifndef CHART_H
+#define CHART_H
+
+#include <stdint.h>
+
+/* Trend chart on the LCD. Every series keeps the last CHART_LEN samples quantised to one byte,
+   the visible one is drawn auto-scaled into a bank aligned region of LCD.Cache. */
+
+// Samples per series, also the width of the plot in pixels. One sample a minute = one hour.
+#define CHART_LEN			60
+// Plot region: columns CHART_X .. CHART_X + CHART_LEN - 1, banks CHART_BANK .. + CHART_BANKS - 1
+#define CHART_X				24
+#define CHART_BANK			3
+#define CHART_BANKS			3
+// Seconds between two samples
+#define CHART_PERIOD		60
+
+// Quantised value of a missing sample (sensor not ready, invalid reading)
+#define CHART_NODATA		0xFF
+
+typedef enum {
+	CHART_CO2,						// ppm
+	CHART_TEMPERATURE,				// 0.1 C
+	CHART_HUMIDITY,					// 0.1 %RH
+	CHART_SERIES
+} chartSeries_Type;
+
+typedef enum {
+	CHART_LINE,
+	CHART_BARS
+} chartStyle_Type;
+
+typedef struct {
+	int16_t base;					// value of quantised 0
+	uint8_t shift;					// quantisation step = 2^shift
+	uint8_t style;					// chartStyle_Type
+} chartConfig_Type;
+
+void chartInit(void);
+void chartPush(uint8_t series, int16_t value);
+void chartPushMissing(uint8_t series);
+void chartShow(uint8_t series);
+uint8_t chartRange(int16_t * low, int16_t * high);
+
+#endif
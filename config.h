@@ -6,4 +6,11 @@
 #define F_CPU 16000000UL
 #endif
 
+// Backlight output
+#define BACKLIGHT_OC0B	1		// PORTD.5, PWM generated by Timer0 in hardware (no interrupts)
+#define BACKLIGHT_SOFT	2		// PORTB.1, software PWM from two Timer2 interrupts (62.5 kHz each)
+#ifndef BACKLIGHT
+#define BACKLIGHT BACKLIGHT_OC0B
+#endif
+
 #endif
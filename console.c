@@ -0,0 +1,138 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Minimal command interpreter. consolePoll() is called from the main loop, collects 
+			the characters received by the UART and runs the matching handler when a line
+			ends. Nothing here blocks.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "uart.h"
+#include "console.h"
+#include "mg811cal.h"
+#include "mirror.h"
+#include "keys.h"
+#include "humidity.h"
+#include "vent.h"
+#include "relay.h"
+#include "rtc.h"
+#include "schedule.h"
+
+static void consoleHelp(char * args);
+
+/*** Command names ***/
+static const char cmdHelp[] PROGMEM = "help";
+static const char cmdCal[] PROGMEM = "cal";
+static const char cmdLcd[] PROGMEM = "lcd";
+static const char cmdKey[] PROGMEM = "key";
+static const char cmdHum[] PROGMEM = "hum";
+static const char cmdVent[] PROGMEM = "vent";
+static const char cmdRelay[] PROGMEM = "relay";
+static const char cmdClock[] PROGMEM = "clock";
+static const char cmdSched[] PROGMEM = "sched";
+
+static const consoleCommandType consoleCommands[] PROGMEM = {
+	{ cmdHelp,	consoleHelp },
+	{ cmdCal,	MG811_CalCommand },
+	{ cmdLcd,	mirrorCommand },
+	{ cmdKey,	keyCommand },
+	{ cmdHum,	humidityCommand },
+	{ cmdVent,	ventCommand },
+	{ cmdRelay,	relayCommand },
+	{ cmdClock,	rtcCommand },
+	{ cmdSched,	scheduleCommand },
+};
+
+#define CONSOLE_COMMANDS	(sizeof(consoleCommands) / sizeof(consoleCommands[0]))
+
+#if RXBUF_SIZE <= CONSOLE_LINE_SIZE
+#error "RXBUF_SIZE must hold a whole console line"
+#endif
+
+static char line[CONSOLE_LINE_SIZE];
+static uint8_t length;
+static uint8_t lost;		// 2 after an overrun, 1 for the last line to drop
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Terminates the current argument and returns the next one
+  Return		: 	pointer to the next argument (empty string if none)
+-------------------------------------------------------------------------------------------------**/
+char * consoleNextArg(char * args)
+{
+	while ( *args && *args != ' ' )
+		args++;
+	while ( *args == ' ' )
+		*args++ = '\0';
+	return args;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Looks up the command in consoleCommands[] and runs it
+-------------------------------------------------------------------------------------------------**/
+static void consoleExec(char * cmdline)
+{
+	consoleCommandType command;
+	char * args;
+	uint8_t i;
+
+	while ( *cmdline == ' ' )
+		cmdline++;
+	if ( !*cmdline )
+		return;
+	args = consoleNextArg(cmdline);
+
+	for ( i = 0; i < CONSOLE_COMMANDS; i++ )
+	{
+		memcpy_P(&command, &consoleCommands[i], sizeof(command));
+		if ( !strcmp_P(cmdline, command.name) )
+		{
+			command.handler(args);
+			return;
+		}
+	}
+	printf_P(PSTR("\n%s?"), cmdline);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Processes the received characters. Call from the main loop. The characters
+					dropped by the UART follow the ones in its buffer, so after an overrun every
+					line that ends until the buffer is seen empty, and the line in progress then,
+					are not run.
+-------------------------------------------------------------------------------------------------**/
+void consolePoll(void)
+{
+	int16_t c;
+
+	for ( ;; )
+	{
+		if ( uartOverruns() )
+			lost = 2;
+		if ( (c = uartPoll()) < 0 )
+			break;
+		if ( c == '\r' || c == '\n' )
+		{
+			line[length] = '\0';
+			length = 0;
+			if ( !lost )
+				consoleExec(line);
+			else
+			{
+				printf_P(PSTR("\nRX: overrun, line dropped"));
+				if ( lost == 1 )
+					lost = 0;
+			}
+		}
+		else if ( length < CONSOLE_LINE_SIZE - 1 )
+			line[length++] = c;
+	}
+	if ( lost == 2 )
+		lost = 1;
+}
+
+static void consoleHelp(char * args)
+{
+	uint8_t i;
+
+	for ( i = 0; i < CONSOLE_COMMANDS; i++ )
+		printf_P(PSTR("\n%S"), (const char *)pgm_read_word(&consoleCommands[i].name));
+}
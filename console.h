@@ -0,0 +1,22 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+
+/* Line based command interface on the UART. Commands are listed in consoleCommands[] 
+   (console.c); a handler receives the rest of the line with leading spaces removed. */
+
+// Longest accepted command line including arguments
+#define CONSOLE_LINE_SIZE	32
+
+typedef void (*consoleHandlerType)(char * args);
+
+typedef struct {
+	const char * name;				// string in .progmem
+	consoleHandlerType handler;
+} consoleCommandType;
+
+void consolePoll(void);
+char * consoleNextArg(char * args);
+
+#endif
@@ -7,6 +7,8 @@
 #include "dht22.h"
 #include "lph7366.h"
 #include "fifo.h"
+#include "filter.h"
+#include "timer0.h"
 
 // #define DHT22_PIN_DEBUG
 
@@ -28,6 +30,12 @@ volatile StateMachine_Type dhtstate = IDLE;
 volatile uint16_t prevICR;
 
 DHT22_Info_Type DHT22_Info;
+// Set by the first reading that passed the checksum, getTicks() of the last one
+static volatile uint8_t valid;
+static volatile uint32_t readAt;
+
+// Spike rejection on the raw readings (tenths of degree / percent)
+static filterMedian5_Type tfilter, hfilter;
 
 float DHT22_ReadTemperature()
 {
@@ -41,6 +49,26 @@ float DHT22_ReadHumidity()
 	return DHT22_Info.Humidity;
 }
 
+/**--------------------------------------------------------------------------------------------------
+  Description	:  Copies the last reading. Unlike the two functions above it leaves the state 
+				   machine alone, so it can be called at any time, even during a transfer.
+  Return		:  age of the reading in seconds, DHT22_NO_READING until the first one. A failed
+				   or missing transfer leaves the last reading, which only gets older.
+--------------------------------------------------------------------------------------------------**/
+uint16_t DHT22_Last(DHT22_Info_Type * info)
+{
+	uint8_t sreg = SREG;
+	uint32_t age;
+
+	cli();
+	*info = DHT22_Info;
+	age = ( getTicks() - readAt ) / 1000;
+	SREG = sreg;
+	if ( !valid )
+		return DHT22_NO_READING;
+	return age < DHT22_NO_READING ? age : DHT22_NO_READING - 1;
+}
+
 DHT22_STATE_Type DHT22_State(void)
 {
 	if( dhtstate == READY )
@@ -213,10 +241,12 @@ ISR(TIMER1_CAPT_vect)
 					else
 						sign = 1;
 					temperature &= ~0x8000;
-					DHT22_Info.Temperature = (float) temperature / 10 * sign + DHT22_OFFSET;
-					DHT22_Info.Humidity = (float) humidity / 10;
+					DHT22_Info.Temperature = (float) filterMedian5(&tfilter, (int16_t)temperature * sign) / 10 + DHT22_OFFSET;
+					DHT22_Info.Humidity = (float) filterMedian5(&hfilter, humidity) / 10;
 					
 					dhtstate = READY;
+					valid = 1;
+					readAt = getTicks();
 					rxdata = 0;
 					idx = 0;
 					
@@ -15,6 +15,9 @@
 // empirically adjust the offset to get more accurate results. 
 #define DHT22_OFFSET (-2.0)
 
+// DHT22_Last() before the first reading
+#define DHT22_NO_READING	0xffff
+
 
 typedef struct {
 	float Temperature;
@@ -32,6 +35,7 @@ extern DHT22_Info_Type DHT22_Info;
 void DHT22_Read(void);
 float DHT22_ReadTemperature(void);
 float DHT22_ReadHumidity(void);
+uint16_t DHT22_Last(DHT22_Info_Type * info);
 DHT22_STATE_Type DHT22_State(void);
 
 #endif
@@ -90,6 +90,17 @@ int8_t fifoWrite(fifoType * buffer, int8_t character)
 	}
 }
 
+/**--------------------------------------------------------------------------------------------------
+  Name         :  fifoCount.
+  Description  :  Number of characters waiting in the buffer.
+  Argument(s)  :  Pointer to a fifoType buffer.
+  Return value :  Count, at most size - 1.
+--------------------------------------------------------------------------------------------------**/
+uint16_t fifoCount(fifoType * buffer)
+{
+	return (buffer->fempty + buffer->size - buffer->ffilled) % buffer->size;
+}
+
 /**--------------------------------------------------------------------------------------------------
   Name         :  fifoFlush.
   Description  :  Function flush the buffer contents.
@@ -45,6 +45,9 @@ uint8_t fifoReadAtIndex(fifoType *, uint16_t);
 /** Function to add a char at end of given buffer **/
 int8_t fifoWrite(fifoType *, int8_t);
 
+/** Number of chars waiting in a given buffer **/
+uint16_t fifoCount(fifoType *);
+
 /** Flush the contents of a given buffer **/
 void fifoFlush(fifoType * );
 
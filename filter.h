@@ -0,0 +1,164 @@
+/**------------------------------------------------------------------------------------------------
+  Name		:	filter.h
+  Description :	Integer filters for sensor streams. Each filter keeps its state in a fixed size
+				struct owned by the caller, so every channel can have its own instance. 
+				No floats, no division by a variable.
+
+				filterEMA	 - exponential moving average, alpha = 1 / 2^shift
+				filterMedian5 - running median of the last 5 samples (spike rejection)
+				filterMedian7 - running median of the last 7 samples
+				filterBoxcar	 - running mean of the last FILTER_BOXCAR_LEN samples
+				
+				The first sample fills the whole window, so there is no start-up ramp.
+-------------------------------------------------------------------------------------------------**/
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+
+// Window of filterBoxcar. Must be a power of 2.
+#ifndef FILTER_BOXCAR_LEN
+#define FILTER_BOXCAR_LEN	8
+#endif
+
+#if FILTER_BOXCAR_LEN & (FILTER_BOXCAR_LEN - 1)
+	#error FILTER_BOXCAR_LEN must be a power of 2.
+#endif
+
+typedef struct {
+	int32_t acc;			// output scaled by 2^shift
+	uint8_t shift;
+	uint8_t primed;
+} filterEMA_Type;
+
+typedef struct {
+	int16_t window[5];
+	uint8_t idx;
+	uint8_t primed;
+} filterMedian5_Type;
+
+typedef struct {
+	int16_t window[7];
+	uint8_t idx;
+	uint8_t primed;
+} filterMedian7_Type;
+
+typedef struct {
+	int16_t window[FILTER_BOXCAR_LEN];
+	int32_t sum;
+	uint8_t idx;
+	uint8_t primed;
+} filterBoxcar_Type;
+
+// Compare-exchange step of the sorting networks
+#define FILTER_SORT(a, b)	do { if ( (a) > (b) ) { int16_t t = (a); (a) = (b); (b) = t; } } while (0)
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Initializers. The EMA time constant is about 2^shift samples.
+-------------------------------------------------------------------------------------------------**/
+static inline void filterEMAInit(filterEMA_Type * f, uint8_t shift)
+{
+	f->shift = shift;
+	f->primed = 0;
+}
+
+static inline void filterMedian5Init(filterMedian5_Type * f)
+{
+	f->primed = 0;
+}
+
+static inline void filterMedian7Init(filterMedian7_Type * f)
+{
+	f->primed = 0;
+}
+
+static inline void filterBoxcarInit(filterBoxcar_Type * f)
+{
+	f->primed = 0;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Feed one sample, return the filtered value
+-------------------------------------------------------------------------------------------------**/
+static inline int16_t filterEMA(filterEMA_Type * f, int16_t x)
+{
+	if ( !f->primed )
+	{
+		f->acc = (int32_t)x << f->shift;
+		f->primed = 1;
+	}
+	else
+		f->acc += x - (f->acc >> f->shift);
+
+	return f->acc >> f->shift;
+}
+
+static inline int16_t filterMedian5(filterMedian5_Type * f, int16_t x)
+{
+	int16_t p0, p1, p2, p3, p4;
+	uint8_t i;
+
+	if ( !f->primed )
+	{
+		for ( i = 0; i < 5; i++ )
+			f->window[i] = x;
+		f->idx = 0;
+		f->primed = 1;
+	}
+	f->window[f->idx] = x;
+	if ( ++f->idx == 5 )
+		f->idx = 0;
+
+	p0 = f->window[0]; p1 = f->window[1]; p2 = f->window[2]; p3 = f->window[3]; p4 = f->window[4];
+	FILTER_SORT(p0, p1); FILTER_SORT(p3, p4); FILTER_SORT(p0, p3);
+	FILTER_SORT(p1, p4); FILTER_SORT(p1, p2); FILTER_SORT(p2, p3);
+	FILTER_SORT(p1, p2);
+	return p2;
+}
+
+static inline int16_t filterMedian7(filterMedian7_Type * f, int16_t x)
+{
+	int16_t p0, p1, p2, p3, p4, p5, p6;
+	uint8_t i;
+
+	if ( !f->primed )
+	{
+		for ( i = 0; i < 7; i++ )
+			f->window[i] = x;
+		f->idx = 0;
+		f->primed = 1;
+	}
+	f->window[f->idx] = x;
+	if ( ++f->idx == 7 )
+		f->idx = 0;
+
+	p0 = f->window[0]; p1 = f->window[1]; p2 = f->window[2]; p3 = f->window[3]; 
+	p4 = f->window[4]; p5 = f->window[5]; p6 = f->window[6];
+	FILTER_SORT(p0, p5); FILTER_SORT(p0, p3); FILTER_SORT(p1, p6);
+	FILTER_SORT(p2, p4); FILTER_SORT(p0, p1); FILTER_SORT(p3, p5);
+	FILTER_SORT(p2, p6); FILTER_SORT(p2, p3); FILTER_SORT(p3, p6);
+	FILTER_SORT(p4, p5); FILTER_SORT(p1, p4); FILTER_SORT(p1, p3);
+	FILTER_SORT(p3, p4);
+	return p3;
+}
+
+static inline int16_t filterBoxcar(filterBoxcar_Type * f, int16_t x)
+{
+	uint8_t i;
+
+	if ( !f->primed )
+	{
+		for ( i = 0; i < FILTER_BOXCAR_LEN; i++ )
+			f->window[i] = x;
+		f->sum = (int32_t)x * FILTER_BOXCAR_LEN;
+		f->idx = 0;
+		f->primed = 1;
+	}
+	f->sum += x - f->window[f->idx];
+	f->window[f->idx] = x;
+	f->idx = (f->idx + 1) & (FILTER_BOXCAR_LEN - 1);
+
+	return f->sum / FILTER_BOXCAR_LEN;
+}
+
+#endif
@@ -0,0 +1,178 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Font rendering. A character is found by walking the (few) ranges of the font, the
+			glyph columns are then copied to the cache with dColumn. Scaled text is expanded
+			column by column while drawing, so big digits cost no flash: Font5x7 at scale 2
+			or 3 replaces the pre-scaled digit tables. The font data itself is generated from
+			the BDF files in fonts/ (see fontdata.h in the Makefile).
+-------------------------------------------------------------------------------------------------**/
+#include <stdint.h>
+#include <string.h>
+#include "lph7366.h"
+#include "font.h"
+
+#include "fontdata.h"
+
+static const font_Type * current = &Font5x7;
+static uint8_t currentScale = 1;
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Looks a character up in a font
+  Argument(s)	:	font -> in .progmem, ch -> character, width -> receives the glyph columns
+  Return		: 	first column of the glyph in .progmem, NULL if the font does not have it
+-------------------------------------------------------------------------------------------------**/
+const uint8_t * fontGlyph(const font_Type * font, uint8_t ch, uint8_t * width)
+{
+	font_Type f;
+	fontRange_Type range;
+	uint16_t start;
+	uint8_t i, glyph;
+
+	memcpy_P(&f, font, sizeof(f));
+	for ( i = 0; i < f.nranges; i++ )
+	{
+		memcpy_P(&range, &f.ranges[i], sizeof(range));
+		if ( ch < range.first )
+			break;
+		if ( ch - range.first >= range.count )
+			continue;
+
+		glyph = range.glyph + ch - range.first;
+		if ( f.columns )
+		{
+			start = pgm_read_word(&f.columns[glyph]);
+			*width = pgm_read_word(&f.columns[glyph + 1]) - start;
+		}
+		else
+		{
+			start = (uint16_t)glyph * f.width;
+			*width = f.width;
+		}
+		return f.bitmap + start * f.rows;
+	}
+	return NULL;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Stretches one glyph column vertically by scale into out bytes
+-------------------------------------------------------------------------------------------------**/
+static void fontScale(const uint8_t * src, uint8_t rows, uint8_t scale, uint8_t * col, uint8_t out)
+{
+	uint8_t i, k, b = 0;
+	uint16_t o = 0;
+
+	if ( scale == 1 )
+	{
+		memcpy_P(col, src, out);
+		return;
+	}
+
+	memset(col, 0, out);
+	for ( i = 0; i < rows * 8; i++ )
+	{
+		if ( (i & 7) == 0 )
+			b = pgm_read_byte(src++);
+		for ( k = 0; k < scale; k++, o++ )
+			if ( (b & 1) && o / 8 < out )
+				col[o / 8] |= 1 << (o % 8);
+		b >>= 1;
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Draws a character of a font at any pixel position, opaque, clipped at the
+					screen edges, and marks the touched spans dirty.
+  Argument(s)	:	font -> in .progmem, scale -> 1.., x, y -> top left pixel, ch -> character
+  Return		: 	advance in pixels, 0 if the font does not have the character
+-------------------------------------------------------------------------------------------------**/
+uint8_t fontDraw(const font_Type * font, uint8_t scale, uint8_t x, uint8_t y, uint8_t ch)
+{
+	const uint8_t * src;
+	uint8_t col[LCD_LINES];
+	uint8_t width, rows, spacing, out, c, k, bank;
+	uint16_t pos = x, end;
+
+	if ( !scale || !(src = fontGlyph(font, ch, &width)) )
+		return 0;
+
+	rows = pgm_read_byte(&font->rows);
+	spacing = pgm_read_byte(&font->spacing);
+	out = rows * scale;
+	if ( out > LCD_LINES )
+		out = LCD_LINES;
+
+	for ( c = 0; c < width + spacing && pos < X_RES; c++ )
+	{
+		if ( c < width )
+		{
+			fontScale(src, rows, scale, col, out);
+			src += rows;
+		}
+		else
+			memset(col, 0, out);
+
+		for ( k = 0; k < scale && pos < X_RES; k++, pos++ )
+			dColumn(pos, y, col, out);
+	}
+
+	// Banks touched: out, plus one when not aligned to a bank
+	end = y / 8 + out + ( y % 8 ? 1 : 0 );
+	if ( pos > x )
+		for ( bank = y / 8; bank < end && bank < LCD_LINES; bank++ )
+			dDirty(bank, x, pos - 1);
+
+	return (width + spacing) * scale;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Selects the font and scale used by fontChar, fontText and fontWidth
+-------------------------------------------------------------------------------------------------**/
+void fontSelect(const font_Type * font, uint8_t scale)
+{
+	current = font;
+	currentScale = scale;
+}
+
+uint8_t fontChar(uint8_t x, uint8_t y, uint8_t ch)
+{
+	return fontDraw(current, currentScale, x, y, ch);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Prints a string from RAM (fontText) or .progmem (fontText_P) with the
+					selected font
+  Return		: 	x after the text, may be past X_RES when clipped
+-------------------------------------------------------------------------------------------------**/
+uint16_t fontText(uint8_t x, uint8_t y, const char * string)
+{
+	uint16_t pos = x;
+
+	while ( *string && pos < X_RES )
+		pos += fontDraw(current, currentScale, pos, y, *string++);
+	return pos;
+}
+
+uint16_t fontText_P(uint8_t x, uint8_t y, const char * string)
+{
+	uint16_t pos = x;
+	uint8_t ch;
+
+	while ( (ch = pgm_read_byte(string++)) && pos < X_RES )
+		pos += fontDraw(current, currentScale, pos, y, ch);
+	return pos;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Width of a string in the selected font, for right or centre alignment
+-------------------------------------------------------------------------------------------------**/
+uint16_t fontWidth(const char * string)
+{
+	font_Type f;
+	uint16_t w = 0;
+	uint8_t width;
+
+	memcpy_P(&f, current, sizeof(f));
+	while ( *string )
+		if ( fontGlyph(current, *string++, &width) )
+			w += (width + f.spacing) * currentScale;
+	return w;
+}
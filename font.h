@@ -0,0 +1,46 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+#include "lph7366.h"
+
+/* Packed bitmap fonts in .progmem, generated from BDF files by tools/fontgen (see fontdata.h).
+   A glyph is a run of LCD columns, rows bytes each, top bank first, bit 0 = top pixel. */
+
+typedef struct {
+	uint8_t first;					// first character of the range
+	uint8_t count;					// characters in the range
+	uint8_t glyph;					// index of the glyph of the first character
+} fontRange_Type;
+
+typedef struct {
+	const uint8_t * bitmap;			// all glyphs, column after column
+	const uint16_t * columns;		// first column of each glyph and one past the last,
+									// NULL for fixed width fonts
+	const fontRange_Type * ranges;	// characters present, ascending
+	uint8_t nranges;
+	uint8_t rows;					// height in banks
+	uint8_t width;					// fixed width fonts: columns per glyph
+	uint8_t spacing;				// blank columns after each glyph
+} font_Type;
+
+/* Fonts built by the Makefile */
+extern const font_Type Font5x7 PROGMEM;		// ASCII 32..126, fixed width, the dChar font
+extern const font_Type FontIcons PROGMEM;	// proportional, codes below
+
+#define ICON_THERMOMETER	"\x01"
+#define ICON_DROP			"\x02"
+#define ICON_SUN			"\x03"
+#define ICON_SPROUT			"\x04"
+#define ICON_DEGREE			"\xb0"
+
+const uint8_t * fontGlyph(const font_Type * font, uint8_t ch, uint8_t * width);
+uint8_t fontDraw(const font_Type * font, uint8_t scale, uint8_t x, uint8_t y, uint8_t ch);
+
+void fontSelect(const font_Type * font, uint8_t scale);
+uint8_t fontChar(uint8_t x, uint8_t y, uint8_t ch);
+uint16_t fontText(uint8_t x, uint8_t y, const char * string);
+uint16_t fontText_P(uint8_t x, uint8_t y, const char * string);
+uint16_t fontWidth(const char * string);
+
+#endif
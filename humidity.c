@@ -0,0 +1,230 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Humidity controller. It works only from humidityTick(), once a second, so every
+			decision is taken on the same clock as the timing limits; humiditySample() only 
+			stores the reading and its time. The limits are checked in order of priority: 
+			disabled, stale data and duty limit stop the pump at once, the minimum on and off
+			times only delay the decisions of the hysteresis. The run time of the last hour is
+			a sum over HUM_SLOTS slots that is updated, never recomputed, at every tick.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "timer0.h"
+#include "nvm.h"
+#include "relay.h"
+#include "console.h"
+#include "humidity.h"
+
+static humiditySettings_Type settings = {
+	1, HUM_SETPOINT, HUM_BAND, HUM_MIN_ON, HUM_MIN_OFF, HUM_MAX_DUTY
+};
+
+static humidityStatus_Type status;
+
+static uint8_t sampled;				// a plausible reading arrived at least once
+static uint32_t lastSample;
+static uint32_t lastSwitch;
+
+static uint16_t slots[HUM_SLOTS];	// run time per slot, s
+static uint8_t slot;
+static uint16_t slotTime;
+
+static uint8_t running;				// pump requested by the controller
+
+static void humidityRelay(uint8_t on)
+{
+	if ( on == running )
+		return;
+
+	running = on;
+	lastSwitch = getTicks();
+	relayRequest(RELAY_PUMP, RELAY_AUTO, on ? RELAY_ON : RELAY_OFF);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Loads the settings and stops the pump. The minimum off time starts now.
+-------------------------------------------------------------------------------------------------**/
+void humidityInit(void)
+{
+	humiditySettings_Type record;
+
+	if ( nvmLoad(NVM_HUMIDITY, &record, sizeof(record), HUM_VERSION) )
+		settings = record;
+
+	running = 0;
+	relayRequest(RELAY_PUMP, RELAY_AUTO, RELAY_OFF);
+	status.setpoint = settings.setpoint;
+	status.state = HUM_STALE_DATA;
+	lastSwitch = getTicks();
+}
+
+static void humiditySave(void)
+{
+	nvmSave(NVM_HUMIDITY, &settings, sizeof(settings), HUM_VERSION);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Passes a new DHT22 reading, in tenths of %RH. Readings out of 0..100 % are
+					ignored and let the data go stale.
+-------------------------------------------------------------------------------------------------**/
+void humiditySample(int16_t humidity)
+{
+	if ( humidity < 0 || humidity > 1000 )
+		return;
+
+	status.humidity = humidity;
+	lastSample = getTicks();
+	sampled = 1;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Runs the controller. Call once per second.
+-------------------------------------------------------------------------------------------------**/
+void humidityTick(void)
+{
+	uint32_t now = getTicks();
+	uint32_t since = now - lastSwitch;
+	uint8_t dry, wet;
+
+	// Run time of the last hour
+	if ( ++slotTime == HUM_SLOT_S )
+	{
+		slotTime = 0;
+		if ( ++slot == HUM_SLOTS )
+			slot = 0;
+		status.runTime -= slots[slot];
+		slots[slot] = 0;
+	}
+	status.relay = relayState(RELAY_PUMP);
+	if ( status.relay )
+	{
+		slots[slot]++;
+		status.runTime++;
+	}
+
+	dry = (int16_t)status.humidity < (int16_t)(status.setpoint - settings.band);
+	wet = status.humidity >= status.setpoint;
+
+	// The duty limit also stops a pump switched on by hand
+	relayRequest(RELAY_PUMP, RELAY_SAFETY, 
+		status.runTime >= settings.maxDuty * 36U ? RELAY_OFF : RELAY_RELEASE);
+
+	if ( !settings.enabled )
+	{
+		status.state = HUM_DISABLED;
+		humidityRelay(0);
+	}
+	else if ( !sampled || now - lastSample > HUM_STALE * 1000UL )
+	{
+		status.state = HUM_STALE_DATA;
+		humidityRelay(0);
+	}
+	else if ( status.runTime >= settings.maxDuty * 36U )
+	{
+		status.state = HUM_LIMIT;
+		humidityRelay(0);
+	}
+	else if ( running )
+	{
+		if ( !wet )
+			status.state = HUM_ON;
+		else if ( since < settings.minOn * 1000UL )
+			status.state = HUM_HOLD;
+		else
+		{
+			status.state = HUM_IDLE;
+			humidityRelay(0);
+		}
+	}
+	else
+	{
+		if ( !dry )
+			status.state = HUM_IDLE;
+		else if ( since < settings.minOff * 1000UL )
+			status.state = HUM_WAIT;
+		else
+		{
+			status.state = HUM_ON;
+			humidityRelay(1);
+		}
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Enables or disables the control and saves it. Disabled stops the pump at the
+					next tick.
+-------------------------------------------------------------------------------------------------**/
+void humidityEnable(uint8_t on)
+{
+	settings.enabled = on;
+	humiditySave();
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Changes the setpoint in use, for the schedule. The saved one is left alone,
+					so the settings written by the console or the keys never take it.
+  Argument(s)	:	setpoint -> tenths of %RH
+-------------------------------------------------------------------------------------------------**/
+void humidityTarget(uint16_t setpoint)
+{
+	status.setpoint = setpoint;
+}
+
+const humidityStatus_Type * humidityStatus(void)
+{
+	return &status;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Console command, humidities in tenths of %RH
+					hum						- show the settings and the state
+					hum on|off				- enable or disable the control
+					hum set <rh> [band]		- setpoint and band below it
+					hum time <on> <off>		- minimum on and off times in seconds
+					hum duty <%>			- maximum run time per hour
+					hum default				- restore the compile time settings
+-------------------------------------------------------------------------------------------------**/
+void humidityCommand(char * args)
+{
+	char * value = consoleNextArg(args);
+	char * value2 = consoleNextArg(value);
+
+	if ( !strcmp_P(args, PSTR("on")) )
+		settings.enabled = 1;
+	else if ( !strcmp_P(args, PSTR("off")) )
+		settings.enabled = 0;
+	else if ( !strcmp_P(args, PSTR("set")) && atoi(value) > 0 && atoi(value) <= 1000 )
+	{
+		settings.setpoint = atoi(value);
+		status.setpoint = settings.setpoint;
+		if ( *value2 )
+			settings.band = atoi(value2);
+	}
+	else if ( !strcmp_P(args, PSTR("time")) && *value2 )
+	{
+		settings.minOn = atoi(value);
+		settings.minOff = atoi(value2);
+	}
+	else if ( !strcmp_P(args, PSTR("duty")) && atoi(value) > 0 && atoi(value) <= 100 )
+		settings.maxDuty = atoi(value);
+	else if ( !strcmp_P(args, PSTR("default")) )
+	{
+		settings.setpoint = HUM_SETPOINT;
+		status.setpoint = settings.setpoint;
+		settings.band = HUM_BAND;
+		settings.minOn = HUM_MIN_ON;
+		settings.minOff = HUM_MIN_OFF;
+		settings.maxDuty = HUM_MAX_DUTY;
+	}
+
+	if ( *args )
+		humiditySave();
+
+	printf_P(PSTR("\nHUM: %S sp %u band %u on %u s off %u s duty %u %%"), 
+		settings.enabled ? PSTR("on") : PSTR("off"), 
+		settings.setpoint, settings.band, settings.minOn, settings.minOff, settings.maxDuty);
+	printf_P(PSTR("\nHUM: state %u pump %u rh %u run %u s sp now %u"), 
+		status.state, status.relay, status.humidity, status.runTime, status.setpoint);
+}
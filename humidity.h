@@ -0,0 +1,65 @@
+#ifndef HUMIDITY_H
+#define HUMIDITY_H
+
+#include <stdint.h>
+
+/* Closed loop humidity control with the pump relay (RELAY_PUMP). The pump starts below 
+   setpoint - band and stops at the setpoint, but only after running HUM_MIN_ON seconds, and
+   it never restarts before HUM_MIN_OFF seconds. Independently of that it is stopped when it
+   has run for the duty limit in the last hour, even if switched on by hand, and when the
+   DHT22 has not delivered a plausible reading for HUM_STALE seconds. humidityTick() is 
+   called once a second; humidities are in tenths of %RH. */
+
+// Compile time defaults of the settings
+#define HUM_SETPOINT		850
+#define HUM_BAND			30
+#define HUM_MIN_ON			20		// s
+#define HUM_MIN_OFF			60		// s
+#define HUM_MAX_DUTY		25		// % of an hour
+
+// Readings older than this stop the pump
+#define HUM_STALE			30		// s
+
+// The run time of the last hour is kept in HUM_SLOTS slots of HUM_SLOT_S seconds
+#define HUM_SLOTS			12
+#define HUM_SLOT_S			300
+
+// Increment when the layout of humiditySettings_Type changes
+#define HUM_VERSION			1
+
+typedef struct {
+	uint8_t enabled;
+	uint16_t setpoint;				// tenths of %RH
+	uint16_t band;					// tenths of %RH below the setpoint
+	uint16_t minOn;					// s
+	uint16_t minOff;				// s
+	uint8_t maxDuty;				// % of an hour
+} humiditySettings_Type;
+
+typedef enum {
+	HUM_DISABLED,					// pump off, control disabled
+	HUM_IDLE,						// pump off, humidity high enough
+	HUM_WAIT,						// pump off, too dry but HUM_MIN_OFF not elapsed
+	HUM_ON,							// pump on, too dry
+	HUM_HOLD,						// pump on, humidity reached but HUM_MIN_ON not elapsed
+	HUM_LIMIT,						// pump off, duty limit of the hour reached
+	HUM_STALE_DATA					// pump off, no recent plausible reading
+} humidityState_Type;
+
+typedef struct {
+	uint8_t state;					// humidityState_Type
+	uint8_t relay;					// 1 while the pump runs, whoever asked for it
+	uint16_t humidity;				// last plausible reading
+	uint16_t runTime;				// s of pump run time in the last hour
+	uint16_t setpoint;				// in use: the saved one, or the schedule's until the next "hum set"
+} humidityStatus_Type;
+
+void humidityInit(void);
+void humiditySample(int16_t humidity);
+void humidityTick(void);
+void humidityEnable(uint8_t on);
+void humidityTarget(uint16_t setpoint);
+const humidityStatus_Type * humidityStatus(void);
+void humidityCommand(char * args);
+
+#endif
@@ -0,0 +1,497 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Multi protocol IR decoder. INT1_vect takes Timer1 and Timer0 readings on every edge
+			and stores one byte per interval, nothing else. The ring is lock free: only the ISR
+			moves irHead, only the main loop moves irTail. irService() feeds the intervals to every
+			decoder in turn and calls the handler for every decoded frame, so the application
+			never runs in interrupt context and the ISR takes the same time whatever it does.
+			A decoder that sees something its protocol cannot produce waits for the gap after
+			the frame (IR_WAIT), which replaces the Timer1 COMPA pause of the old RC5 state
+			machine. The main loop adds a gap after IR_GAP_MS without edges, so frames end even
+			when no further edge arrives.
+-------------------------------------------------------------------------------------------------**/
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "utils.h"
+#include "timer0.h"
+#include "ir.h"
+
+#if IR_RING_SIZE & (IR_RING_SIZE - 1)
+	#error IR_RING_SIZE must be a power of 2.
+#endif
+
+// Timer1 ticks (prescaler 8 at 16 MHz: 0.5 us) to IR_UNIT_US
+#define IR_TICKS_SHIFT	7
+
+/*** Decoder states ***/
+typedef enum {
+	IR_IDLE,						// waiting for a leader (or the first mark, without leader)
+	IR_LEADER,						// leader mark received
+	IR_DATA,
+	IR_STOP,						// frame or repeat code complete, waiting for the gap
+	IR_WAIT							// error, waiting for the gap
+} irState_Type;
+
+/*** Results of a decoder step ***/
+#define IR_NONE			0
+#define IR_FRAME		1
+#define IR_REPEAT_CODE	2
+
+typedef struct {
+	uint8_t state;
+	uint8_t bits;
+	uint8_t half;					// biphase: first half of the current bit, 0 none, 1 space, 2 mark
+									// distance: 1 after the mark of a bit
+	uint32_t data;
+} irDecoder_Type;
+
+static uint8_t rc5Finish(uint32_t data, uint8_t bits, irEvent_Type * ev);
+static uint8_t rc6Finish(uint32_t data, uint8_t bits, irEvent_Type * ev);
+static uint8_t necFinish(uint32_t data, uint8_t bits, irEvent_Type * ev);
+static uint8_t sonyFinish(uint32_t data, uint8_t bits, irEvent_Type * ev);
+
+static const irProtocol_Type irProtocols[IR_PROTOCOLS] PROGMEM = {
+	/* encoding			flags							leader		repeat	unit	one		bits	wide		finish */
+	{ IR_BIPHASE,		IR_MSB_FIRST,					0,		0,		0,		889,	0,		14, 14,	IR_NO_WIDE,	rc5Finish },
+	{ IR_BIPHASE,		IR_MSB_FIRST | IR_MARK_FIRST,	2666,	889,	0,		444,	0,		21, 21,	4,			rc6Finish },
+	{ IR_PULSE_DISTANCE, 0,								9000,	4500,	2250,	560,	1690,	32, 32,	IR_NO_WIDE,	necFinish },
+	{ IR_PULSE_WIDTH,	0,								2400,	600,	0,		600,	1200,	12, 20,	IR_NO_WIDE,	sonyFinish },
+};
+
+/* Raw intervals, written by INT1_vect */
+static volatile uint8_t irRing[IR_RING_SIZE];
+static volatile uint8_t irHead;
+static volatile uint8_t irTail;
+static volatile uint8_t irOverflow;
+static uint16_t irLastEdge;
+static uint8_t irLastMs;
+static uint8_t irIdleLevel;
+
+/* Decoders, only used by irPoll */
+static irDecoder_Type irDecoders[IR_PROTOCOLS];
+static irEvent_Type last;
+static uint8_t lastToggle;
+static uint32_t lastTime;
+static uint8_t gapSent;
+static uint32_t edgeTime;			// ms of the last edge taken from the ring
+static uint16_t edgeUs;				// and the us above it
+static uint32_t frameEnd;			// ms of the last edge before the gap being decoded
+static irHandler_Type irHandler;
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Sets INT1 (PD3) up to interrupt on both edges of the receiver output
+  Argument(s)	:	handler -> called by irService() for every decoded frame
+					polarity -> IR_NORMAL or IR_INVERTED
+-------------------------------------------------------------------------------------------------**/
+void irInit(irHandler_Type handler, uint8_t polarity)
+{
+	uint8_t i;
+
+	irHandler = handler;
+
+	cbi(DDRD,3); // PD3(INT1)
+	sbi(PORTD,3); // pullup
+	// Pin level without carrier
+	irIdleLevel = ( polarity == IR_INVERTED ) ? _BV(3) : 0;
+
+	for ( i = 0; i < IR_PROTOCOLS; i++ )
+		irDecoders[i].state = IR_WAIT;
+	last.protocol = IR_PROTOCOLS;
+
+	EICRA = (EICRA & ~(1<<ISC11)) | (1<<ISC10); // any logical change
+	EIFR = (1<<INTF1);
+	EIMSK |= (1<<INT1);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Compares a measured length with a protocol timing, 25% tolerance plus one
+					unit for the quantisation of the ring
+-------------------------------------------------------------------------------------------------**/
+static uint8_t irMatch(uint16_t us, uint16_t ref)
+{
+	uint16_t tol = ref / 4 + IR_UNIT_US;
+
+	return us + tol >= ref && us <= ref + tol;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Adds a bit to the frame
+  Return		: 	0 if the frame is already complete
+-------------------------------------------------------------------------------------------------**/
+static uint8_t irBit(irDecoder_Type * d, const irProtocol_Type * p, uint8_t bit)
+{
+	if ( d->bits >= p->bitsMax )
+		return 0;
+	if ( p->flags & IR_MSB_FIRST )
+		d->data = (d->data << 1) | bit;
+	else if ( bit )
+		d->data |= 1UL << d->bits;
+	d->bits++;
+	return 1;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Adds a half bit of a biphase frame, builds a bit from every pair
+  Argument(s)	:	mark -> level of the half bit
+  Return		: 	0 on error (no level change in the middle of the bit)
+-------------------------------------------------------------------------------------------------**/
+static uint8_t irHalf(irDecoder_Type * d, const irProtocol_Type * p, uint8_t mark)
+{
+	if ( !d->half )
+	{
+		d->half = mark + 1;
+		return 1;
+	}
+	if ( d->half == mark + 1 )
+		return 0;
+	d->half = 0;
+	return irBit(d, p, ( p->flags & IR_MARK_FIRST ) ? !mark : mark);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Splits an interval of a biphase frame into half bits
+  Return		: 	0 if it is not a whole number of half bits
+-------------------------------------------------------------------------------------------------**/
+static uint8_t irBiphase(irDecoder_Type * d, const irProtocol_Type * p, uint8_t mark, uint16_t us)
+{
+	uint8_t units = (us + p->unit / 2) / p->unit;
+	uint8_t width;
+
+	if ( units == 0 || units > 3 )
+		return 0;
+	while ( units )
+	{
+		width = ( d->bits == p->wideBit ) ? 2 : 1;
+		if ( units < width || !irHalf(d, p, mark) )
+			return 0;
+		units -= width;
+	}
+	return 1;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	End of a frame (gap). Checks the frame and builds the event.
+  Return		: 	IR_FRAME or IR_REPEAT_CODE if ev holds an event, else IR_NONE
+-------------------------------------------------------------------------------------------------**/
+static uint8_t irEnd(irDecoder_Type * d, const irProtocol_Type * p, uint8_t id, irEvent_Type * ev)
+{
+	uint8_t state = d->state;
+
+	d->state = IR_IDLE;
+
+	if ( p->encoding == IR_BIPHASE && state == IR_DATA )
+	{
+		// The space of a bit ending with a mark is part of the gap
+		if ( d->half == 2 && !irHalf(d, p, 0) )
+			return IR_NONE;
+		state = d->half ? IR_WAIT : IR_STOP;
+	}
+	else if ( p->encoding == IR_PULSE_WIDTH && state == IR_DATA )
+		state = IR_STOP;
+
+	if ( state != IR_STOP )
+		return IR_NONE;
+
+	// Repeat code: the last event again, if it came from this protocol
+	if ( !d->bits && p->repeatSpace )
+	{
+		if ( last.protocol != id || frameEnd - lastTime >= IR_REPEAT_MS )
+			return IR_NONE;
+		lastTime = frameEnd;
+		*ev = last;
+		ev->repeat = 1;
+		ev->time = frameEnd;
+		return IR_REPEAT_CODE;
+	}
+
+	if ( d->bits < p->bitsMin || !p->finish(d->data, d->bits, ev) )
+		return IR_NONE;
+	ev->protocol = id;
+	ev->time = frameEnd;
+	return IR_FRAME;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Runs one decoder on one interval
+  Argument(s)	:	e -> ring entry, id -> protocol
+  Return		: 	see irEnd
+-------------------------------------------------------------------------------------------------**/
+static uint8_t irStep(uint8_t id, uint8_t e, irEvent_Type * ev)
+{
+	irProtocol_Type p;
+	irDecoder_Type * d = &irDecoders[id];
+	uint8_t mark = ( e & IR_MARK ) ? 1 : 0;
+	uint16_t us = (e & IR_SATURATED) * IR_UNIT_US + IR_UNIT_US / 2;
+
+	memcpy_P(&p, &irProtocols[id], sizeof(p));
+
+	if ( !mark && (e & IR_SATURATED) == IR_SATURATED )
+		return irEnd(d, &p, id, ev);
+
+	switch ( d->state ) {
+		case IR_IDLE:
+			if ( !mark )
+				break;
+			d->bits = 0;
+			d->data = 0;
+			d->half = 0;
+			if ( p.leaderMark )
+			{
+				d->state = irMatch(us, p.leaderMark) ? IR_LEADER : IR_WAIT;
+				break;
+			}
+			// No leader (RC5): the frame starts in the middle of the start bit, after its space
+			d->state = IR_DATA;
+			d->half = 1;
+			if ( !irBiphase(d, &p, mark, us) )
+				d->state = IR_WAIT;
+			break;
+
+		case IR_LEADER:
+			if ( irMatch(us, p.leaderSpace) )
+				d->state = IR_DATA;
+			else if ( p.repeatSpace && irMatch(us, p.repeatSpace) )
+				d->half = 1, d->state = IR_DATA;		// only the stop mark follows
+			else
+				d->state = IR_WAIT;
+			break;
+
+		case IR_DATA:
+			switch ( p.encoding ) {
+				case IR_BIPHASE:
+					if ( !irBiphase(d, &p, mark, us) )
+						d->state = IR_WAIT;
+					break;
+
+				case IR_PULSE_DISTANCE:
+					if ( mark )
+					{
+						if ( !irMatch(us, p.unit) )
+							d->state = IR_WAIT;
+						else if ( d->bits == p.bitsMax || ( d->half && !d->bits ) )
+							d->state = IR_STOP;			// stop mark of a frame or of a repeat code
+						else
+							d->half = 1;
+					}
+					else if ( d->half && irMatch(us, p.unit) )
+						d->half = 0, irBit(d, &p, 0);
+					else if ( d->half && irMatch(us, p.one) )
+						d->half = 0, irBit(d, &p, 1);
+					else
+						d->state = IR_WAIT;
+					break;
+
+				case IR_PULSE_WIDTH:
+					if ( !mark )
+					{
+						if ( !irMatch(us, p.unit) )
+							d->state = IR_WAIT;
+					}
+					else if ( irMatch(us, p.unit) )
+						d->state = irBit(d, &p, 0) ? IR_DATA : IR_WAIT;
+					else if ( irMatch(us, p.one) )
+						d->state = irBit(d, &p, 1) ? IR_DATA : IR_WAIT;
+					else
+						d->state = IR_WAIT;
+					break;
+			}
+			break;
+
+		case IR_STOP:
+			d->state = IR_WAIT;
+			break;
+	}
+	return IR_NONE;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Passes one interval to every decoder and sets the repeat flag of a new event
+  Return		: 	1 if ev holds an event
+-------------------------------------------------------------------------------------------------**/
+static uint8_t irFeed(uint8_t e, irEvent_Type * ev)
+{
+	irEvent_Type frame;
+	uint8_t id, found = IR_NONE, result, toggle;
+
+	for ( id = 0; id < IR_PROTOCOLS; id++ )
+	{
+		result = irStep(id, e, &frame);
+		if ( result && !found )
+		{
+			found = result;
+			*ev = frame;
+		}
+	}
+	if ( found != IR_FRAME )
+		return found != IR_NONE;
+
+	// A new frame is a held key if it is the same as the last one, toggle bit included
+	toggle = ev->repeat;
+	ev->repeat = ev->protocol == last.protocol && ev->address == last.address &&
+				 ev->command == last.command && toggle == lastToggle && ev->time - lastTime < IR_REPEAT_MS;
+	lastTime = ev->time;
+	lastToggle = toggle;
+	last = *ev;
+	last.repeat = 0;
+	return 1;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Decodes the intervals received so far. Keeps the time of the edges: the
+					newest one is exact (Timer0 reading of the ISR), older ones are summed up
+					from the interval lengths.
+  Argument(s)	:	ev -> receives the event
+  Return		: 	1 if a frame (or a repeat code) was decoded, call again until it returns 0
+-------------------------------------------------------------------------------------------------**/
+static uint8_t irPoll(irEvent_Type * ev)
+{
+	uint8_t e, id, empty, ms, sreg;
+	uint32_t now;
+
+	if ( irOverflow )
+	{
+		irOverflow = 0;
+		for ( id = 0; id < IR_PROTOCOLS; id++ )
+			irDecoders[id].state = IR_WAIT;
+	}
+
+	while ( irTail != irHead )
+	{
+		e = irRing[irTail];
+		irTail = (irTail + 1) & (IR_RING_SIZE - 1);
+		// A gap ends the frame at the edge before it
+		frameEnd = edgeTime;
+
+		sreg = SREG;
+		cli();
+		empty = irTail == irHead;
+		ms = irLastMs;
+		SREG = sreg;
+		if ( empty )
+		{
+			now = getTicks();
+			edgeTime = now - (uint8_t)((uint8_t)now - ms);
+			edgeUs = 0;
+		}
+		else
+		{
+			edgeUs += (e & IR_SATURATED) * IR_UNIT_US;
+			edgeTime += edgeUs / 1000;
+			edgeUs %= 1000;
+		}
+
+		gapSent = 0;
+		if ( irFeed(e, ev) )
+			return 1;
+	}
+
+	// No edge for longer than any interval of a frame: the receiver is idle
+	if ( !gapSent && getTicks() - edgeTime > IR_GAP_MS )
+	{
+		gapSent = 1;
+		frameEnd = edgeTime;
+		return irFeed(IR_SATURATED, ev);
+	}
+	return 0;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Called from the main loop. Decodes the intervals received so far and calls
+					the handler for every frame.
+-------------------------------------------------------------------------------------------------**/
+void irService(void)
+{
+	irEvent_Type ev;
+
+	while ( irPoll(&ev) )
+		if ( irHandler )
+			irHandler(&ev);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Frame checks, see irProtocol_Type.finish
+-------------------------------------------------------------------------------------------------**/
+static uint8_t rc5Finish(uint32_t data, uint8_t bits, irEvent_Type * ev)
+{
+	// S1 S2 T A4..A0 C5..C0, S2 inverted is bit 6 of the command (extended RC5)
+	if ( !(data & 0x2000) )
+		return 0;
+	ev->address = (data >> 6) & 0x1f;
+	ev->command = (data & 0x3f) | ( (data & 0x1000) ? 0 : 0x40 );
+	ev->repeat = (data >> 11) & 1;
+	return 1;
+}
+
+static uint8_t rc6Finish(uint32_t data, uint8_t bits, irEvent_Type * ev)
+{
+	// Start bit 1, mode 000, T, A7..A0, C7..C0
+	if ( (data >> 17) != 0x08 )
+		return 0;
+	ev->address = (data >> 8) & 0xff;
+	ev->command = data & 0xff;
+	ev->repeat = (data >> 16) & 1;
+	return 1;
+}
+
+static uint8_t necFinish(uint32_t data, uint8_t bits, irEvent_Type * ev)
+{
+	// A7..A0, ~A7..~A0 (extended: A15..A8), C7..C0, ~C7..~C0, LSB first
+	uint8_t command = data >> 16;
+
+	if ( (uint8_t)(data >> 24) != (uint8_t)~command )
+		return 0;
+	if ( (uint8_t)(data >> 8) == (uint8_t)~(uint8_t)data )
+		ev->address = (uint8_t)data;
+	else
+		ev->address = (uint16_t)data;
+	ev->command = command;
+	ev->repeat = 0;
+	return 1;
+}
+
+static uint8_t sonyFinish(uint32_t data, uint8_t bits, irEvent_Type * ev)
+{
+	// C6..C0 then 5, 8 or 5 + 8 address bits, LSB first
+	if ( bits != 12 && bits != 15 && bits != 20 )
+		return 0;
+	ev->command = data & 0x7f;
+	ev->address = data >> 7;
+	ev->repeat = 0;
+	return 1;
+}
+
+// Everything above runs in the main loop. Keep the decoders and the handler out of the ISR.
+#pragma GCC poison irService irPoll irFeed irStep irEnd irHandler
+
+/**-------------------------------------------------------------------------------------------------
+  Description         :  INT1 interrupt - stores the length and level of the interval that ended
+-------------------------------------------------------------------------------------------------**/
+ISR(INT1_vect)
+{
+	uint16_t now = TCNT1;
+	uint8_t ms = Ticks;
+	uint16_t length = (uint16_t)(now - irLastEdge) >> IR_TICKS_SHIFT;
+	uint8_t e, next;
+
+	// Timer1 wraps every 32 ms, Timer0 tells if the interval was that long
+	if ( length > IR_SATURATED || (uint8_t)(ms - irLastMs) > (IR_SATURATED * IR_UNIT_US) / 1000 )
+		length = IR_SATURATED;
+	irLastEdge = now;
+	irLastMs = ms;
+
+	// No carrier now: the interval that ended was a mark
+	e = length;
+	if ( (PIND & _BV(3)) == irIdleLevel )
+		e |= IR_MARK;
+
+	next = (irHead + 1) & (IR_RING_SIZE - 1);
+	if ( next == irTail )
+		irOverflow = 1;
+	else
+	{
+		irRing[irHead] = e;
+		irHead = next;
+	}
+}
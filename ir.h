@@ -0,0 +1,92 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdint.h>
+
+/* Infrared remote front end. INT1 fires on both edges of the receiver output and the ISR only
+   stores the length and level of the interval that just ended in a ring buffer. The protocol
+   decoders run on that ring from the main loop (irService), which also calls the handler
+   given to irInit() for every frame. Each decoder is the same small state machine driven by
+   the timings of its irProtocols[] entry (ir.c), so adding a protocol adds a table row and a
+   finish function, and nothing to the ISR. */
+
+/*** Receiver output polarity, argument of irInit() ***/
+#define IR_NORMAL		0	// output high while the carrier is received
+#define IR_INVERTED		1	// output low while the carrier is received (TSOP and alike)
+
+/*** Raw ring entries: bit 7 is the level, bits 0..6 the length in 64 us units ***/
+#define IR_UNIT_US		64
+#define IR_MARK			0x80	// the interval was carrier
+#define IR_SATURATED	0x7f	// 8.1 ms or longer
+// Number of intervals kept, power of 2. Frames are decoded while they arrive, so this only
+// has to cover the time the main loop may be busy (one NEC bit is two intervals in 1.1 ms).
+// Event times stay exact as long as irService() runs at least every 255 ms.
+#define IR_RING_SIZE	32
+
+// Silence that ends a frame, longer than any interval inside one (NEC leader mark: 9 ms)
+#define IR_GAP_MS		12
+// The same frame again within this time is a held key (Sony auto repeat, RC5/RC6 with the
+// same toggle bit, NEC repeat codes). RC5 repeats every 114 ms, NEC every 108 ms.
+#define IR_REPEAT_MS	150
+
+/*** Commands of the original RC5 remote ***/
+#define UP 16
+#define DOWN 17
+#define LEFT 21
+#define RIGHT 22
+#define POWER 12
+#define MENU 18
+#define CHUP 32
+#define CHDOWN 33
+#define AV 56
+
+/* Protocols, keep in the same order as irProtocols[] */
+typedef enum {
+	IR_RC5,
+	IR_RC6,							// mode 0
+	IR_NEC,							// and extended NEC (16-bit address)
+	IR_SONY,						// SIRC 12, 15 and 20 bits
+	IR_PROTOCOLS
+} irProtocolId_Type;
+
+typedef struct {
+	uint8_t protocol;				// irProtocolId_Type
+	uint16_t address;
+	uint8_t command;
+	uint8_t repeat;					// 1 while the key is held
+	uint32_t time;					// getTicks() at the last edge of the frame
+} irEvent_Type;
+
+// Called from the main loop by irService(). Takes a pointer, so an ISR cannot be passed.
+typedef void (*irHandler_Type)(const irEvent_Type * ev);
+
+typedef enum {
+	IR_PULSE_DISTANCE,				// constant mark, the space carries the bit (NEC)
+	IR_PULSE_WIDTH,					// constant space, the mark carries the bit (Sony)
+	IR_BIPHASE						// Manchester, a level change in the middle of every bit (RC5, RC6)
+} irEncoding_Type;
+
+/*** irProtocol_Type flags ***/
+#define IR_MSB_FIRST	0x01
+#define IR_MARK_FIRST	0x02		// biphase: a 1 is mark then space (RC6), else space then mark (RC5)
+#define IR_NO_WIDE		0xff
+
+typedef struct {
+	uint8_t encoding;				// irEncoding_Type
+	uint8_t flags;
+	uint16_t leaderMark;			// us, 0 = no leader
+	uint16_t leaderSpace;			// us
+	uint16_t repeatSpace;			// us, space after the leader mark of a repeat code, 0 = none
+	uint16_t unit;					// us, DISTANCE: mark and 0 space, WIDTH: 0 mark and space, BIPHASE: half bit
+	uint16_t one;					// us, DISTANCE: 1 space, WIDTH: 1 mark
+	uint8_t bitsMin, bitsMax;		// frame length, biphase counts the start bits too
+	uint8_t wideBit;				// biphase bit with halves of two units (RC6 trailer), IR_NO_WIDE if none
+	// Checks a complete frame and fills address and command. Puts the toggle bit, if the
+	// protocol has one, in repeat. Returns 0 if the frame is not valid.
+	uint8_t (*finish)(uint32_t data, uint8_t bits, irEvent_Type * ev);
+} irProtocol_Type;
+
+void irInit(irHandler_Type handler, uint8_t polarity);
+void irService(void);
+
+#endif
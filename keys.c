@@ -0,0 +1,381 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Key layer. keyIr() gets the frames of irService() and finds their key: first in the
+			learned bindings, which stay in EEPROM sorted by (protocol, address, command) and
+			are binary searched there, then, for the accepted remotes, in keyMap[]. Only one
+			key is tracked at a time: a different key releases the current one. keyService()
+			releases the key when its frames stop and generates the hold events, so holding
+			CH+ steps faster than the 114 ms RC5 frame rate.
+			In learning mode the next frame of any remote is bound to the key being learned.
+			Inserting a binding moves the ones after it, about 3.4 ms per changed byte.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "timer0.h"
+#include "nvm.h"
+#include "console.h"
+#include "ir.h"
+#include "keys.h"
+
+/*** Remotes whose frames are accepted. Anything else in the room is ignored. ***/
+static const keyRemote_Type keyRemotes[] PROGMEM = {
+	/* protocol	address */
+	{ IR_RC5,	0 },				// RC5 system 0 (TV), the original remote
+};
+
+/*** Commands of the accepted remotes ***/
+static const keyMap_Type keyMap[] PROGMEM = {
+	/* protocol	command	key */
+	{ IR_RC5,	POWER,	KEY_POWER },
+	{ IR_RC5,	UP,		KEY_UP },
+	{ IR_RC5,	DOWN,	KEY_DOWN },
+	{ IR_RC5,	LEFT,	KEY_LEFT },
+	{ IR_RC5,	RIGHT,	KEY_RIGHT },
+	{ IR_RC5,	MENU,	KEY_MENU },
+	{ IR_RC5,	AV,		KEY_AV },
+	{ IR_RC5,	CHUP,	KEY_CHUP },
+	{ IR_RC5,	CHDOWN,	KEY_CHDOWN },
+	{ IR_RC5,	1,		KEY_1 },
+	{ IR_RC5,	2,		KEY_2 },
+	{ IR_RC5,	3,		KEY_3 },
+};
+
+#define KEY_REMOTES		(sizeof(keyRemotes) / sizeof(keyRemotes[0]))
+#define KEY_MAP_SIZE	(sizeof(keyMap) / sizeof(keyMap[0]))
+
+/*** Key names ***/
+static const char keyPower[] PROGMEM = "power";
+static const char keyUp[] PROGMEM = "up";
+static const char keyDown[] PROGMEM = "down";
+static const char keyLeft[] PROGMEM = "left";
+static const char keyRight[] PROGMEM = "right";
+static const char keyMenu[] PROGMEM = "menu";
+static const char keyAv[] PROGMEM = "av";
+static const char keyChUp[] PROGMEM = "ch+";
+static const char keyChDown[] PROGMEM = "ch-";
+static const char key1[] PROGMEM = "1";
+static const char key2[] PROGMEM = "2";
+static const char key3[] PROGMEM = "3";
+
+// Keep in the same order as keyId_Type
+static const keyInfo_Type keyInfo[KEYS] PROGMEM = {
+	/* name		flags */
+	{ NULL,			0 },		// KEY_NONE
+	{ keyPower,		0 },
+	{ keyUp,		KEY_F_REPEAT },
+	{ keyDown,		KEY_F_REPEAT },
+	{ keyLeft,		KEY_F_REPEAT },
+	{ keyRight,		KEY_F_REPEAT },
+	{ keyMenu,		0 },
+	{ keyAv,		0 },
+	{ keyChUp,		KEY_F_REPEAT },
+	{ keyChDown,	KEY_F_REPEAT },
+	{ key1,			0 },
+	{ key2,			0 },
+	{ key3,			0 },
+};
+
+static keyHandler_Type keyHandler;
+
+/* Key being held */
+static uint8_t current;				// KEY_NONE if no key is down
+static uint8_t holdCount;
+static uint16_t holdInterval;
+static uint32_t lastFrame;			// irEvent_Type.time of the last frame of the key
+static uint32_t nextHold;
+
+/* Learned bindings */
+static uint8_t learned;				// bindings in EEPROM, 0 if the record is not valid
+static uint8_t learning;			// key waiting for a frame, KEY_NONE if not learning
+static uint8_t learnAll;			// go on with the next key after a binding
+static uint32_t learnTime;
+
+static void keySend(uint8_t key, uint8_t action, uint8_t count)
+{
+	keyEvent_Type ev;
+
+	ev.key = key;
+	ev.action = action;
+	ev.count = count;
+	if ( keyHandler )
+		keyHandler(&ev);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Sets the function that receives the key events and checks the learned
+					bindings. Pass keyIr to irInit().
+-------------------------------------------------------------------------------------------------**/
+void keyInit(keyHandler_Type handler)
+{
+	keyHandler = handler;
+	current = KEY_NONE;
+	learning = KEY_NONE;
+
+	learned = 0;
+	if ( nvmValid(NVM_KEYMAP, KEY_LEARN_SIZE, KEY_LEARN_VERSION) )
+		nvmRead(NVM_KEYMAP, 0, &learned, 1);
+	if ( learned > KEY_LEARN_MAX )
+		learned = 0;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Name of a key, in .progmem
+-------------------------------------------------------------------------------------------------**/
+const char * keyName(uint8_t key)
+{
+	return ( key < KEYS ) ? (const char *)pgm_read_word(&keyInfo[key].name) : NULL;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Sort order of the bindings
+-------------------------------------------------------------------------------------------------**/
+static uint32_t keyCode(uint8_t protocol, uint16_t address, uint8_t command)
+{
+	return ((uint32_t)protocol << 24) | ((uint32_t)address << 8) | command;
+}
+
+static void keyReadBinding(uint8_t i, keyBinding_Type * b)
+{
+	nvmRead(NVM_KEYMAP, 1 + i * sizeof(*b), b, sizeof(*b));
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Binary search in the learned bindings
+  Return		: 	index of the first binding not below code (learned if none), the binding
+					itself in b when the index is below learned
+-------------------------------------------------------------------------------------------------**/
+static uint8_t keyFind(uint32_t code, keyBinding_Type * b)
+{
+	uint8_t low = 0, high = learned, mid;
+
+	while ( low < high )
+	{
+		mid = (low + high) / 2;
+		keyReadBinding(mid, b);
+		if ( keyCode(b->protocol, b->address, b->command) < code )
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if ( low < learned )
+		keyReadBinding(low, b);
+	return low;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Binds a frame to a key, replaces the binding of the same frame if any
+  Return		: 	0 if the table is full
+-------------------------------------------------------------------------------------------------**/
+static uint8_t keyBind(const irEvent_Type * ev, uint8_t key)
+{
+	keyBinding_Type b;
+	uint32_t code = keyCode(ev->protocol, ev->address, ev->command);
+	uint8_t i = keyFind(code, &b), j;
+
+	if ( i == learned || keyCode(b.protocol, b.address, b.command) != code )
+	{
+		if ( learned == KEY_LEARN_MAX )
+			return 0;
+		for ( j = learned; j > i; j-- )
+		{
+			keyReadBinding(j - 1, &b);
+			nvmWrite(NVM_KEYMAP, 1 + j * sizeof(b), &b, sizeof(b));
+		}
+		learned++;
+		nvmWrite(NVM_KEYMAP, 0, &learned, 1);
+	}
+
+	b.protocol = ev->protocol;
+	b.address = ev->address;
+	b.command = ev->command;
+	b.key = key;
+	nvmWrite(NVM_KEYMAP, 1 + i * sizeof(b), &b, sizeof(b));
+	nvmSeal(NVM_KEYMAP, KEY_LEARN_SIZE, KEY_LEARN_VERSION);
+	return 1;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Key of a frame
+  Return		: 	KEY_NONE if the frame has no binding or comes from an unknown remote
+-------------------------------------------------------------------------------------------------**/
+static uint8_t keyLookup(const irEvent_Type * ev)
+{
+	keyBinding_Type b;
+	keyRemote_Type r;
+	keyMap_Type m;
+	uint32_t code = keyCode(ev->protocol, ev->address, ev->command);
+	uint8_t i;
+
+	// A record of another keyId_Type layout may hold any key
+	if ( keyFind(code, &b) < learned && keyCode(b.protocol, b.address, b.command) == code )
+		return ( b.key < KEYS ) ? b.key : KEY_NONE;
+
+	for ( i = 0; i < KEY_REMOTES; i++ )
+	{
+		memcpy_P(&r, &keyRemotes[i], sizeof(r));
+		if ( r.protocol == ev->protocol && ( r.address == KEY_ANY_ADDRESS || r.address == ev->address ) )
+			break;
+	}
+	if ( i == KEY_REMOTES )
+		return KEY_NONE;
+
+	for ( i = 0; i < KEY_MAP_SIZE; i++ )
+	{
+		memcpy_P(&m, &keyMap[i], sizeof(m));
+		if ( m.protocol == ev->protocol && m.command == ev->command )
+			return m.key;
+	}
+	return KEY_NONE;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Starts (or stops) learning mode
+  Argument(s)	:	key -> first key to learn, KEY_NONE stops
+					all -> 1 goes on with the following keys, up to the last one
+-------------------------------------------------------------------------------------------------**/
+void keyLearn(uint8_t key, uint8_t all)
+{
+	learning = ( key < KEYS ) ? key : KEY_NONE;
+	learnAll = all;
+	learnTime = getTicks();
+	if ( learning != KEY_NONE )
+		printf_P(PSTR("\nKEY: press %S"), keyName(learning));
+	else
+		printf_P(PSTR("\nKEY: %u learned"), learned);
+	keySend(learning, KEY_LEARN, 0);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	A frame in learning mode. The AV key of a known remote skips the key.
+-------------------------------------------------------------------------------------------------**/
+static void keyLearnFrame(const irEvent_Type * ev)
+{
+	if ( ev->repeat )
+		return;
+
+	if ( keyLookup(ev) != KEY_AV || learning == KEY_AV )
+	{
+		if ( !keyBind(ev, learning) )
+		{
+			printf_P(PSTR("\nKEY: full"));
+			keyLearn(KEY_NONE, 0);
+			return;
+		}
+		printf_P(PSTR("\nKEY: %S = %u %u %u"), keyName(learning), ev->protocol, ev->address, ev->command);
+	}
+	keyLearn(learnAll ? learning + 1 : KEY_NONE, learnAll);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	IR handler, called by irService() for every frame
+-------------------------------------------------------------------------------------------------**/
+void keyIr(const irEvent_Type * ev)
+{
+	uint8_t key;
+
+	if ( learning != KEY_NONE )
+	{
+		keyLearnFrame(ev);
+		return;
+	}
+
+	key = keyLookup(ev);
+	if ( key == KEY_NONE )
+		return;
+
+	// Same key still held
+	if ( ev->repeat && key == current )
+	{
+		lastFrame = ev->time;
+		return;
+	}
+
+	if ( current != KEY_NONE )
+		keySend(current, KEY_RELEASE, holdCount);
+
+	current = key;
+	holdCount = 0;
+	holdInterval = KEY_HOLD_SLOW_MS;
+	lastFrame = ev->time;
+	nextHold = ev->time + KEY_HOLD_DELAY_MS;
+	keySend(current, KEY_PRESS, 0);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Called from the main loop after irService(). Generates the hold events and
+					the release of the current key, ends learning mode after a timeout.
+-------------------------------------------------------------------------------------------------**/
+void keyService(void)
+{
+	uint32_t now = getTicks();
+	uint8_t key;
+
+	if ( learning != KEY_NONE && now - learnTime > KEY_LEARN_TIMEOUT_MS )
+		keyLearn(KEY_NONE, 0);
+
+	if ( current == KEY_NONE )
+		return;
+
+	if ( now - lastFrame > KEY_RELEASE_MS )
+	{
+		key = current;
+		current = KEY_NONE;
+		keySend(key, KEY_RELEASE, holdCount);
+		return;
+	}
+
+	if ( (pgm_read_byte(&keyInfo[current].flags) & KEY_F_REPEAT) && (int32_t)(now - nextHold) >= 0 )
+	{
+		nextHold = now + holdInterval;
+		if ( holdInterval - holdInterval / 4 > KEY_HOLD_FAST_MS )
+			holdInterval -= holdInterval / 4;
+		else
+			holdInterval = KEY_HOLD_FAST_MS;
+		if ( holdCount < 255 )
+			holdCount++;
+		keySend(current, KEY_HOLD, holdCount);
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Console command "key [learn [name] | clear]". Without argument lists the
+					learned bindings. "learn" goes through all keys, "learn name" only one.
+-------------------------------------------------------------------------------------------------**/
+void keyCommand(char * args)
+{
+	keyBinding_Type b;
+	char * name = consoleNextArg(args);
+	uint8_t i;
+
+	if ( !strcmp_P(args, PSTR("learn")) )
+	{
+		if ( !*name )
+		{
+			keyLearn(KEY_NONE + 1, 1);
+			return;
+		}
+		for ( i = KEY_NONE + 1; i < KEYS; i++ )
+			if ( !strcmp_P(name, keyName(i)) )
+			{
+				keyLearn(i, 0);
+				return;
+			}
+		printf_P(PSTR("\nKEY: %s?"), name);
+		return;
+	}
+
+	if ( !strcmp_P(args, PSTR("clear")) )
+	{
+		learned = 0;
+		nvmWrite(NVM_KEYMAP, 0, &learned, 1);
+		nvmSeal(NVM_KEYMAP, KEY_LEARN_SIZE, KEY_LEARN_VERSION);
+	}
+
+	for ( i = 0; i < learned; i++ )
+	{
+		keyReadBinding(i, &b);
+		printf_P(PSTR("\n%u %u %u %S"), b.protocol, b.address, b.command, ( b.key < KEYS ) ? keyName(b.key) : PSTR("?"));
+	}
+	printf_P(PSTR("\nKEY: %u learned"), learned);
+}
@@ -0,0 +1,101 @@
+#ifndef KEYS_H
+#define KEYS_H
+
+#include <stdint.h>
+#include "ir.h"
+
+/* Key layer on top of the IR decoders. A frame is first looked up in the learned bindings
+   (EEPROM, sorted, binary search). Otherwise frames from remotes that are not in keyRemotes[]
+   (keys.c) are dropped, the others are translated by keyMap[] into keys. A key gives one
+   KEY_PRESS, then, if it has KEY_F_REPEAT in keyInfo[], KEY_HOLD events that start after
+   KEY_HOLD_DELAY_MS and speed up from KEY_HOLD_SLOW_MS to KEY_HOLD_FAST_MS, and one KEY_RELEASE
+   when the frames stop. Hold events are timed by keyService(), not by the frame rate of the
+   remote. */
+
+// No frame of the held key for this long releases it. Longer than the repeat period of any
+// protocol (RC5 114 ms) plus the gap that ends a frame (IR_GAP_MS).
+#define KEY_RELEASE_MS		200
+// Time from the press to the first hold event
+#define KEY_HOLD_DELAY_MS	600
+// Interval of the first hold events, every next one is a quarter shorter down to the fast rate
+#define KEY_HOLD_SLOW_MS	250
+#define KEY_HOLD_FAST_MS	50
+
+typedef enum {
+	KEY_NONE,
+	KEY_POWER,
+	KEY_UP,
+	KEY_DOWN,
+	KEY_LEFT,
+	KEY_RIGHT,
+	KEY_MENU,
+	KEY_AV,
+	KEY_CHUP,
+	KEY_CHDOWN,
+	KEY_1,
+	KEY_2,
+	KEY_3,
+	KEYS
+} keyId_Type;
+
+typedef enum {
+	KEY_PRESS,
+	KEY_HOLD,
+	KEY_RELEASE,
+	KEY_LEARN						// learning mode waits for the key, KEY_NONE when it ends
+} keyAction_Type;
+
+typedef struct {
+	uint8_t key;					// keyId_Type
+	uint8_t action;					// keyAction_Type
+	uint8_t count;					// KEY_HOLD: number of hold events so far, saturates at 255
+} keyEvent_Type;
+
+typedef void (*keyHandler_Type)(const keyEvent_Type * ev);
+
+/*** Accepted remotes ***/
+#define KEY_ANY_ADDRESS		0xffff
+
+typedef struct {
+	uint8_t protocol;				// irProtocolId_Type
+	uint16_t address;				// KEY_ANY_ADDRESS accepts every address of the protocol
+} keyRemote_Type;
+
+/*** Keys ***/
+#define KEY_F_REPEAT		0x01	// the key sends hold events
+
+typedef struct {
+	const char * name;				// in .progmem, for the console and the learning prompt
+	uint8_t flags;
+} keyInfo_Type;
+
+/*** Default keymap ***/
+typedef struct {
+	uint8_t protocol;
+	uint8_t command;
+	uint8_t key;					// keyId_Type
+} keyMap_Type;
+
+/*** Learned bindings, a record at NVM_KEYMAP: count, then the bindings sorted by
+     protocol, address and command ***/
+#define KEY_LEARN_MAX		24
+#define KEY_LEARN_VERSION	1
+#define KEY_LEARN_SIZE		(1 + KEY_LEARN_MAX * sizeof(keyBinding_Type))
+// Learning mode ends when no frame arrives for this long
+#define KEY_LEARN_TIMEOUT_MS	15000
+
+typedef struct {
+	uint8_t protocol;
+	uint16_t address;
+	uint8_t command;
+	uint8_t key;
+} keyBinding_Type;
+
+void keyInit(keyHandler_Type handler);
+void keyIr(const irEvent_Type * ev);
+void keyService(void);
+void keyLearn(uint8_t key, uint8_t all);
+const char * keyName(uint8_t key);
+void keyCommand(char * args);
+
+#endif
@@ -4,13 +4,42 @@
   Author       :  2012-03-26 - Darius Berghe
 --------------------------------------------------------------------------------------------------*/
 #include <stdint.h>
+#ifndef LCD_HOST
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "config.h"
+#include "timer1.h"
+#endif
+#include "timer0.h"
 #include "lph7366.h"
+#include "font.h"
+
+/*--------------------------------------------------------------------------------------------------
+  SPI clock: the fastest fosc divider that stays within LCD_SPI_MAX_HZ
+--------------------------------------------------------------------------------------------------*/
+#ifdef LCD_HOST
+	// No SPI, see lcdHostSend
+#elif F_CPU / 2 <= LCD_SPI_MAX_HZ
+	#define LCD_SPCR_CLK	0
+	#define LCD_SPSR_CLK	(1<<SPI2X)
+#elif F_CPU / 4 <= LCD_SPI_MAX_HZ
+	#define LCD_SPCR_CLK	0
+	#define LCD_SPSR_CLK	0
+#elif F_CPU / 8 <= LCD_SPI_MAX_HZ
+	#define LCD_SPCR_CLK	(1<<SPR0)
+	#define LCD_SPSR_CLK	(1<<SPI2X)
+#else
+	#define LCD_SPCR_CLK	(1<<SPR0)
+	#define LCD_SPSR_CLK	0
+#endif
 
 
 /*--------------------------------------------------------------------------------------------------
                                 Private function prototypes
 --------------------------------------------------------------------------------------------------*/
 static void dSend ( uint8_t data, LcdCmdData cd );
+static void dSendData ( const uint8_t * data, uint16_t count );
+static void dCleanAll ( void );
 
 #ifdef LCD_with_GRAPHICS
 static void RectangleCoordAdjust( uint8_t * x1, uint8_t * y1, uint8_t * x2, uint8_t * y2, uint8_t * ulc, uint8_t * lrc);
@@ -18,117 +47,26 @@ static int8_t min(int8_t el1, int8_t el2);
 static int8_t max(int8_t el1, int8_t el2);
 #endif
 
-#ifdef LCD_with_TEXT
-/*--------------------------------------------------------------------------------------------------
-  This table defines the standard ASCII characters in a 5x7 dot format. It is stored in .progmem.
---------------------------------------------------------------------------------------------------*/
-// char FontTable[1][1];
-
-static const uint8_t FontTable [][5] PROGMEM =
-{
-    { 0x00, 0x00, 0x00, 0x00, 0x00 },  // space
-    { 0x00, 0x00, 0x2f, 0x00, 0x00 },   // !
-    { 0x00, 0x07, 0x00, 0x07, 0x00 },   // "
-    { 0x14, 0x7f, 0x14, 0x7f, 0x14 },   // #
-    { 0x24, 0x2a, 0x7f, 0x2a, 0x12 },   // $
-    { 0xc4, 0xc8, 0x10, 0x26, 0x46 },   // %
-    { 0x36, 0x49, 0x55, 0x22, 0x50 },   // &
-    { 0x00, 0x05, 0x03, 0x00, 0x00 },   // '
-    { 0x00, 0x1c, 0x22, 0x41, 0x00 },   // (
-    { 0x00, 0x41, 0x22, 0x1c, 0x00 },   // )
-    { 0x14, 0x08, 0x3E, 0x08, 0x14 },   // *
-    { 0x08, 0x08, 0x3E, 0x08, 0x08 },   // +
-    { 0x00, 0x00, 0x50, 0x30, 0x00 },   // ,
-    { 0x10, 0x10, 0x10, 0x10, 0x10 },   // -
-    { 0x00, 0x60, 0x60, 0x00, 0x00 },   // .
-    { 0x20, 0x10, 0x08, 0x04, 0x02 },   // /
-    { 0x3E, 0x51, 0x49, 0x45, 0x3E },   // 0
-    { 0x00, 0x42, 0x7F, 0x40, 0x00 },   // 1
-    { 0x42, 0x61, 0x51, 0x49, 0x46 },   // 2
-    { 0x21, 0x41, 0x45, 0x4B, 0x31 },   // 3
-    { 0x18, 0x14, 0x12, 0x7F, 0x10 },   // 4
-    { 0x27, 0x45, 0x45, 0x45, 0x39 },   // 5
-    { 0x3C, 0x4A, 0x49, 0x49, 0x30 },   // 6
-    { 0x01, 0x71, 0x09, 0x05, 0x03 },   // 7
-    { 0x36, 0x49, 0x49, 0x49, 0x36 },   // 8
-    { 0x06, 0x49, 0x49, 0x29, 0x1E },   // 9
-    { 0x00, 0x36, 0x36, 0x00, 0x00 },   // :
-    { 0x00, 0x56, 0x36, 0x00, 0x00 },   // ;
-    { 0x08, 0x14, 0x22, 0x41, 0x00 },   // <
-    { 0x14, 0x14, 0x14, 0x14, 0x14 },   // =
-    { 0x00, 0x41, 0x22, 0x14, 0x08 },   // >
-    { 0x02, 0x01, 0x51, 0x09, 0x06 },   // ?
-    { 0x32, 0x49, 0x59, 0x51, 0x3E },   // @
-    { 0x7E, 0x11, 0x11, 0x11, 0x7E },   // A
-    { 0x7F, 0x49, 0x49, 0x49, 0x36 },   // B
-    { 0x3E, 0x41, 0x41, 0x41, 0x22 },   // C
-    { 0x7F, 0x41, 0x41, 0x22, 0x1C },   // D
-    { 0x7F, 0x49, 0x49, 0x49, 0x41 },   // E
-    { 0x7F, 0x09, 0x09, 0x09, 0x01 },   // F
-    { 0x3E, 0x41, 0x49, 0x49, 0x7A },   // G
-    { 0x7F, 0x08, 0x08, 0x08, 0x7F },   // H
-    { 0x00, 0x41, 0x7F, 0x41, 0x00 },   // I
-    { 0x20, 0x40, 0x41, 0x3F, 0x01 },   // J
-    { 0x7F, 0x08, 0x14, 0x22, 0x41 },   // K
-    { 0x7F, 0x40, 0x40, 0x40, 0x40 },   // L
-    { 0x7F, 0x02, 0x0C, 0x02, 0x7F },   // M
-    { 0x7F, 0x04, 0x08, 0x10, 0x7F },   // N
-    { 0x3E, 0x41, 0x41, 0x41, 0x3E },   // O
-    { 0x7F, 0x09, 0x09, 0x09, 0x06 },   // P
-    { 0x3E, 0x41, 0x51, 0x21, 0x5E },   // Q
-    { 0x7F, 0x09, 0x19, 0x29, 0x46 },   // R
-    { 0x46, 0x49, 0x49, 0x49, 0x31 },   // S
-    { 0x01, 0x01, 0x7F, 0x01, 0x01 },   // T
-    { 0x3F, 0x40, 0x40, 0x40, 0x3F },   // U
-    { 0x1F, 0x20, 0x40, 0x20, 0x1F },   // V
-    { 0x3F, 0x40, 0x38, 0x40, 0x3F },   // W
-    { 0x63, 0x14, 0x08, 0x14, 0x63 },   // X
-    { 0x07, 0x08, 0x70, 0x08, 0x07 },   // Y
-    { 0x61, 0x51, 0x49, 0x45, 0x43 },   // Z
-    { 0x00, 0x7F, 0x41, 0x41, 0x00 },   // [
-    { 0x02, 0x04, 0x08, 0x10, 0x20 },   // backslash
-    { 0x00, 0x41, 0x41, 0x7f, 0x00 },   // ]
-    { 0x04, 0x02, 0x01, 0x02, 0x04 },   // ^
-    { 0x40, 0x40, 0x40, 0x40, 0x40 },   // _
-    { 0x00, 0x01, 0x02, 0x04, 0x00 },   // '
-    { 0x20, 0x54, 0x54, 0x54, 0x78 },   // a
-    { 0x7F, 0x48, 0x44, 0x44, 0x38 },   // b
-    { 0x38, 0x44, 0x44, 0x44, 0x20 },   // c
-    { 0x38, 0x44, 0x44, 0x48, 0x7F },   // d
-    { 0x38, 0x54, 0x54, 0x54, 0x18 },   // e
-    { 0x08, 0x7E, 0x09, 0x01, 0x02 },   // f
-    { 0x0C, 0x52, 0x52, 0x52, 0x3E },   // g
-    { 0x7F, 0x08, 0x04, 0x04, 0x78 },   // h
-    { 0x00, 0x44, 0x7D, 0x40, 0x00 },   // i
-    { 0x20, 0x40, 0x44, 0x3D, 0x00 },   // j
-    { 0x7F, 0x10, 0x28, 0x44, 0x00 },   // k
-    { 0x00, 0x41, 0x7F, 0x40, 0x00 },   // l
-    { 0x7C, 0x04, 0x18, 0x04, 0x78 },   // m
-    { 0x7C, 0x08, 0x04, 0x04, 0x78 },   // n
-    { 0x38, 0x44, 0x44, 0x44, 0x38 },   // o
-    { 0x7C, 0x14, 0x14, 0x14, 0x08 },   // p
-    { 0x08, 0x14, 0x14, 0x18, 0x7C },   // q
-    { 0x7C, 0x08, 0x04, 0x04, 0x08 },   // r
-    { 0x48, 0x54, 0x54, 0x54, 0x20 },   // s
-    { 0x04, 0x3F, 0x44, 0x40, 0x20 },   // t
-    { 0x3C, 0x40, 0x40, 0x20, 0x7C },   // u
-    { 0x1C, 0x20, 0x40, 0x20, 0x1C },   // v
-    { 0x3C, 0x40, 0x30, 0x40, 0x3C },   // w
-    { 0x44, 0x28, 0x10, 0x28, 0x44 },   // x
-    { 0x0C, 0x50, 0x50, 0x50, 0x3C },   // y
-    { 0x44, 0x64, 0x54, 0x4C, 0x44 },   // z
-    { 0x00, 0x08, 0x36, 0x41, 0x00 },   // {
-    { 0x00, 0x00, 0x7f, 0x00, 0x00 },   // |
-    { 0x00, 0x41, 0x36, 0x08, 0x00 },   // }
-    { 0x04, 0x02, 0x04, 0x08, 0x04 }    // ~
-};
-
-#endif
 /*--------------------------------------------------------------------------------------------------
                                       Global Variables
 --------------------------------------------------------------------------------------------------*/
 LCD_t LCD;
 
+/* Frame pacing state of dService */
+static uint8_t urgent;
+static uint32_t lastFrame;
+
+#ifdef LCD_with_ASYNC
+/* Transfer state of dRefreshAsync, owned by SPI_STC_vect while asyncBusy is set */
+static volatile uint8_t asyncBusy;
+static uint8_t asyncCmd;
+static uint8_t asyncBank;
+static int16_t asyncPos;
+static int16_t asyncEnd;
+
+static uint8_t dNextSpan ( void );
+#endif
+
 /*--------------------------------------------------------------------------------------------------
   Name         :  LcdInit
   Description  :  Performs MCU SPI & LCD controller initialization.
@@ -137,9 +75,10 @@ LCD_t LCD;
 --------------------------------------------------------------------------------------------------*/
 void initLCD ( void )
 {
-
-    //  Set output bits on port B.
-    DDRB |= RST_PIN | DC_PIN | CE_PIN | MOSI_PIN | CLK_PIN;
+#ifndef LCD_HOST
+    //  Set output bits on port D (control) and port B (SPI).
+    DDRD |= RST_PIN | DC_PIN | CE_PIN;
+    DDRB |= MOSI_PIN | CLK_PIN | SS_PIN;
     
 	//  Pull-up on reset pin.
     set_LCD_RST;
@@ -148,11 +87,13 @@ void initLCD ( void )
     delay_ms(100);
     set_LCD_RST;
 
-    //  Enable SPI port: No interrupt, MSBit first, Master mode, CPOL->0, CPHA->0, Clk/4
+    //  Enable SPI port: No interrupt, MSBit first, Master mode, CPOL->0, CPHA->0, Clk see LCD_SPI_MAX_HZ
 	SPCR = 0;
-    SPCR = (1<<SPE) | (1<<MSTR) | (1<<SPR0) | (1<<SPR1);
+    SPCR = (1<<SPE) | (1<<MSTR) | LCD_SPCR_CLK;
+	SPSR = LCD_SPSR_CLK;
 
     set_LCD_CE;
+#endif
 	
     dSend( 0x21, LCD_CMD );  // LCD Extended Commands.
     dSend( 0xE0, LCD_CMD );  // Set LCD Vop (Contrast).
@@ -161,8 +102,7 @@ void initLCD ( void )
     dSend( 0x20, LCD_CMD );  // LCD Standard Commands, Horizontal addressing mode.
     dSend( 0x0C, LCD_CMD );  // LCD in normal mode. (0x0D for Inverted Mode)
     
-    LCD.lidx = LCD_CACHE_SIZE - 1;
-	LCD.hidx = 0;
+    dCleanAll();
 } 
 
 /*--------------------------------------------------------------------------------------------------
@@ -174,6 +114,14 @@ void initLCD ( void )
 --------------------------------------------------------------------------------------------------*/
 void dSend ( uint8_t data, LcdCmdData cd )
 {
+#ifdef LCD_with_ASYNC
+	//  Wait for a pending asynchronous refresh.
+	while ( asyncBusy );
+#endif
+
+#ifdef LCD_HOST
+    lcdHostSend( data, cd );
+#else
     //  Enable display controller (active low).
     clr_LCD_CE;
 
@@ -190,6 +138,33 @@ void dSend ( uint8_t data, LcdCmdData cd )
 
     //  Disable display controller.
     set_LCD_CE;
+#endif
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dSendData
+  Description  :  Sends a run of data bytes. CE and DC are set once for the whole run.
+  Argument(s)  :  data  -> First byte to be sent
+                  count -> Number of bytes
+  Return value :  None.
+--------------------------------------------------------------------------------------------------*/
+static void dSendData ( const uint8_t * data, uint16_t count )
+{
+#ifdef LCD_HOST
+    while ( count-- )
+        lcdHostSend( *data++, LCD_DATA );
+#else
+    clr_LCD_CE;
+    set_LCD_DC;
+
+    while ( count-- )
+    {
+        SPDR = *data++;
+        while ( !(SPSR & (1<<SPIF)) );
+    }
+
+    set_LCD_CE;
+#endif
 }
 
 /*--------------------------------------------------------------------------------------------------
@@ -212,43 +187,209 @@ void dContrast ( uint8_t contrast )
 }
 
 /*--------------------------------------------------------------------------------------------------
-  Name         :  dUpdate
-  Description  :  Copies the LCD cache into the device RAM.
+  Name         :  dCleanAll
+  Description  :  Marks all banks as clean.
+  Argument(s)  :  None.
+  Return value :  None.
+--------------------------------------------------------------------------------------------------*/
+static void dCleanAll ( void )
+{
+    uint8_t bank;
+
+    for ( bank = 0; bank < LCD_LINES; bank++ )
+    {
+        LCD.lo[bank] = 0xff;
+        LCD.hi[bank] = 0;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dDirty
+  Description  :  Marks columns x1..x2 of a bank as changed, so the next refresh sends them.
+                  Drawing routines call it; code writing LCD.Cache directly must call it too.
+  Argument(s)  :  bank -> [0..5], x1 <= x2 -> [0..83]
+  Return value :  None.
+--------------------------------------------------------------------------------------------------*/
+void dDirty ( uint8_t bank, uint8_t x1, uint8_t x2 )
+{
+    if ( bank >= LCD_LINES ) return;
+
+#ifdef LCD_with_ASYNC
+    //  SPI_STC_vect resets the span of the bank it starts sending.
+    uint8_t sreg = SREG;
+    cli();
+#endif
+    if ( LCD.lo[bank] > x1 )
+        LCD.lo[bank] = x1;
+    if ( LCD.hi[bank] < x2 )
+        LCD.hi[bank] = x2;
+    LCD.mirror |= 1 << bank;
+#ifdef LCD_with_ASYNC
+    SREG = sreg;
+#endif
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dRefresh
+  Description  :  Copies the dirty span of each bank of the LCD cache into the device RAM.
   Argument(s)  :  None.
   Return value :  None.
 --------------------------------------------------------------------------------------------------*/
 void dRefresh ( void )
 {
-    int i;
-	
-// 	printf("\nLCD.lidx = %d \t LCD.idx = %d \t LCD.hidx = %d",LCD.lidx, LCD.idx, LCD.hidx);
+    uint8_t bank, lo, hi;
 
-	if ( LCD.lidx > LCD.hidx ) return;
-	
-	/* Error handling */
-    if ( LCD.lidx < 0 )
-        LCD.lidx = 0;
-    if ( LCD.lidx >= LCD_CACHE_SIZE )
-        LCD.lidx = LCD_CACHE_SIZE - 1;
+    for ( bank = 0; bank < LCD_LINES; bank++ )
+    {
+        lo = LCD.lo[bank];
+        hi = LCD.hi[bank];
+        if ( lo > hi ) continue;
+        if ( hi >= X_RES )
+            hi = X_RES - 1;
+
+        dSend( 0x40 | bank, LCD_CMD ); // send Y address
+        dSend( 0x80 | lo, LCD_CMD );   // send X address
+        dSendData( &LCD.Cache[bank * X_RES + lo], hi - lo + 1 );
+
+        LCD.lo[bank] = 0xff;
+        LCD.hi[bank] = 0;
+    }
+}
+
+#ifdef LCD_with_ASYNC
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dRefreshAsync
+  Description  :  Starts copying the dirty spans of the LCD cache into the device RAM and returns.
+                  SPI_STC_vect sends the rest. Drawing can go on meanwhile; bytes changed after 
+                  they were sent are marked dirty again and go out with the next refresh.
+  Argument(s)  :  None.
+  Return value :  None.
+--------------------------------------------------------------------------------------------------*/
+void dRefreshAsync ( void )
+{
+    if ( asyncBusy ) return;
 
-    if ( LCD.hidx < 0 )
-        LCD.hidx = 0;
-    if ( LCD.hidx >= LCD_CACHE_SIZE )
-        LCD.hidx = LCD_CACHE_SIZE - 1; 
+    asyncBank = 0;
+    if ( !dNextSpan() ) return;
 
-    dSend( 0x40 | (LCD.lidx / X_RES), LCD_CMD ); // compute and send Y address
-    dSend( 0x80 | (LCD.lidx % X_RES), LCD_CMD ); // compute and send X address
+    asyncBusy = 1;
+    clr_LCD_CE;
+    clr_LCD_DC;
+    SPCR |= (1<<SPIE);
+    SPDR = 0x40 | asyncBank;
+}
 
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dNextSpan
+  Description  :  Takes the dirty span of the first dirty bank from asyncBank on and marks the 
+                  bank clean. Sets the transfer state and the pending X address command.
+  Argument(s)  :  None.
+  Return value :  1 - a span was found, 0 - nothing left to send
+--------------------------------------------------------------------------------------------------*/
+static uint8_t dNextSpan ( void )
+{
+    uint8_t lo, hi;
 
-    //  Send the buffer.
-    for ( i = LCD.lidx; i <= LCD.hidx; i++ )
+    for ( ; asyncBank < LCD_LINES; asyncBank++ )
     {
-        dSend( LCD.Cache[i], LCD_DATA );
+        lo = LCD.lo[asyncBank];
+        hi = LCD.hi[asyncBank];
+        if ( lo > hi ) continue;
+        if ( hi >= X_RES )
+            hi = X_RES - 1;
+
+        LCD.lo[asyncBank] = 0xff;
+        LCD.hi[asyncBank] = 0;
+
+        asyncPos = asyncBank * X_RES + lo;
+        asyncEnd = asyncBank * X_RES + hi;
+        asyncCmd = 0x80 | lo;
+        return 1;
     }
+    return 0;
+}
 
-    //  Reset watermark pointers 
-     LCD.lidx = LCD_CACHE_SIZE - 1;
-     LCD.hidx = 0;
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dBusy
+  Description  :  Checks if an asynchronous refresh is in progress.
+  Argument(s)  :  None.
+  Return value :  1 - busy, 0 - idle
+--------------------------------------------------------------------------------------------------*/
+uint8_t dBusy ( void )
+{
+	return asyncBusy;
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Description  :  SPI transfer complete - for each dirty bank sends the Y and X address, then the
+                  cache bytes of the span one by one.
+--------------------------------------------------------------------------------------------------*/
+ISR ( SPI_STC_vect )
+{
+	if ( asyncCmd )
+	{
+		SPDR = asyncCmd;
+		asyncCmd = 0;
+		return;
+	}
+
+	if ( asyncPos <= asyncEnd )
+	{
+		set_LCD_DC;
+		SPDR = LCD.Cache[asyncPos++];
+		return;
+	}
+
+	asyncBank++;
+	if ( dNextSpan() )
+	{
+		clr_LCD_DC;
+		SPDR = 0x40 | asyncBank;
+		return;
+	}
+
+	set_LCD_CE;
+	SPCR &= ~(1<<SPIE);
+	asyncBusy = 0;
+}
+#endif
+
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dUrgent & dService
+  Description  :  Frame pacing. Drawing only marks the cache dirty; dService, called from the idle
+                  slot of the main loop, sends the dirty spans at most LCD_MAX_FPS times a second,
+                  so any number of changes between two frames cost one transfer. dUrgent lets the
+                  next dService send right away (menu feedback, key echo).
+  Argument(s)  :  None.
+  Return value :  None.
+--------------------------------------------------------------------------------------------------*/
+void dUrgent ( void )
+{
+	urgent = 1;
+}
+
+void dService ( void )
+{
+	uint8_t bank;
+	uint32_t now;
+
+#ifdef LCD_with_ASYNC
+	if ( asyncBusy ) return;
+#endif
+	now = getTicks();
+	if ( !urgent && now - lastFrame < TICK_RATE_HZ / LCD_MAX_FPS ) return;
+
+	for ( bank = 0; bank < LCD_LINES; bank++ )
+		if ( LCD.lo[bank] <= LCD.hi[bank] ) break;
+	if ( bank == LCD_LINES ) return;		// nothing to send, keep the slot open
+
+	urgent = 0;
+	lastFrame = now;
+#ifdef LCD_with_ASYNC
+	dRefreshAsync();
+#else
+	dRefresh();
+#endif
 }
 
 /*--------------------------------------------------------------------------------------------------
@@ -263,9 +404,9 @@ void dClear ( void )
     for ( i = 0; i < LCD_CACHE_SIZE; i++ )
 		LCD.Cache[i] = 0x00;
 	
-     //  Reset watermark pointers.
-    LCD.lidx = 0;
-    LCD.hidx = LCD_CACHE_SIZE - 1;
+    //  Mark the whole screen as dirty.
+    for ( i = 0; i < LCD_LINES; i++ )
+        dDirty( i, 0, X_RES - 1 );
 }
 
 /*--------------------------------------------------------------------------------------------------
@@ -301,8 +442,8 @@ int16_t dCachepos ( uint8_t x, uint8_t y )
 --------------------------------------------------------------------------------------------------*/
 void dCursor ( uint8_t line, uint8_t x )
 {
-	if ( x >= X_RES ) return 0;
-	if ( line >= LCD_LINES ) return 0;
+	if ( x >= X_RES ) return;
+	if ( line >= LCD_LINES ) return;
 	LCD.idx = x + line * X_RES;
 }
 
@@ -314,25 +455,29 @@ void dCursor ( uint8_t line, uint8_t x )
 --------------------------------------------------------------------------------------------------*/
 void dChar ( uint8_t ch )
 {
-	uint8_t i = 0;
-	if ( ch<32 && ch > 127 ) return; // check for valid characters
-	//if ( LCD.idx >= LCD_CACHE_SIZE) return;  // check if not out of screen
-	
-	// Updating low watermark index
-	if ( LCD.lidx > LCD.idx )
-		LCD.lidx = LCD.idx;
+	uint8_t i = 0, width;
+	uint8_t bank = LCD.idx / X_RES;
+	uint8_t x = LCD.idx % X_RES;
+	const uint8_t * glyph = fontGlyph( &Font5x7, ch, &width );
+	if ( !glyph ) return; // check for valid characters
+	if ( LCD.idx > LCD_CACHE_SIZE - 6 ) return;  // check if not out of screen
 	
 	while( i < 5 )
 	{
-		LCD.Cache[LCD.idx++] = pgm_read_byte( & FontTable[ch-32][i]);
+		LCD.Cache[LCD.idx++] = pgm_read_byte( glyph++ );
 		i++; 
 	}
 	
 	LCD.Cache[LCD.idx++] = 0x00; // add space between characters
 	
-	// Updating high watermark index
-	if ( LCD.hidx < LCD.idx )
-		LCD.hidx = LCD.idx;	
+	// Mark the 6 columns dirty, the character may wrap into the next bank
+	if ( x + 6 <= X_RES )
+		dDirty( bank, x, x + 5 );
+	else
+	{
+		dDirty( bank, x, X_RES - 1 );
+		dDirty( bank + 1, 0, x + 5 - X_RES );
+	}
 }
 
 /*--------------------------------------------------------------------------------------------------
@@ -357,6 +502,69 @@ void dText_FF ( const int8_t *conststr )
 		}
 }	
 
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dColumn
+  Description  :  Writes a column of bytes to any pixel position, opaque. Every byte is shifted by
+                  y % 8 and split over two banks. Clips at the screen edges. Does not mark the
+                  cache dirty, the caller does that once for a whole glyph or bitmap.
+  Argument(s)  :  x, y  -> top pixel
+                  bytes -> column in RAM, top byte first, bit 0 = top pixel
+                  n     -> number of bytes
+  Return value :  None.
+--------------------------------------------------------------------------------------------------*/
+void dColumn ( uint8_t x, uint8_t y, const uint8_t *bytes, uint8_t n )
+{
+	uint8_t shift = y % 8;
+	uint8_t bank = y / 8;
+	uint8_t r, b;
+	uint8_t *ptr;
+
+	if ( x >= X_RES ) return;
+
+	ptr = &LCD.Cache[ bank * X_RES + x ];
+	for ( r = 0; r < n && bank + r < LCD_LINES; r++, ptr += X_RES )
+	{
+		b = bytes[r];
+		if ( shift == 0 )
+			*ptr = b;
+		else
+		{
+			*ptr = ( *ptr & ~( 0xff << shift ) ) | ( b << shift );
+			if ( bank + r + 1 < LCD_LINES )
+				ptr[X_RES] = ( ptr[X_RES] & ( 0xff << shift ) ) | ( b >> ( 8 - shift ) );
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dCharAt
+  Description  :  Draws a character of Font5x7 with its top left corner at any pixel ( x, y ),
+                  independent of the text cursor. Other fonts: see font.h.
+  Argument(s)  :  x, y  -> top left pixel
+                  ch    -> character, 32..126
+                  scale -> 1.., every pixel becomes a scale x scale block
+  Return value :  Advance width in pixels ( 6 * scale ), 0 for an invalid character or scale.
+--------------------------------------------------------------------------------------------------*/
+uint8_t dCharAt ( uint8_t x, uint8_t y, uint8_t ch, uint8_t scale )
+{
+	return fontDraw( &Font5x7, scale, x, y, ch );
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dTextAt
+  Description  :  Print a '\0' terminated string from RAM at any pixel position, see dCharAt.
+  Argument(s)  :  x, y -> top left pixel, string, scale -> 1..
+  Return value :  x after the last character, may be past X_RES when clipped.
+--------------------------------------------------------------------------------------------------*/
+uint16_t dTextAt ( uint8_t x, uint8_t y, const char *string, uint8_t scale )
+{
+	uint16_t pos = x;
+
+	while ( *string && pos < X_RES )
+		pos += dCharAt( pos, y, *string++, scale );
+	return pos;
+}
+
 #endif
 
 #ifdef LCD_with_GRAPHICS
@@ -382,10 +590,76 @@ void dPixel( uint8_t x, uint8_t y, LcdPixelMode mode )
 		default: return;
 	}
 	
-	if ( LCD.lidx > LCD.idx )
-		LCD.lidx = LCD.idx;
-	if ( LCD.hidx < LCD.idx )
-		LCD.hidx = LCD.idx;	
+	dDirty( y / 8, x, x );
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dFillRect
+  Description  :  Fills a rectangle a whole cache byte at a time. For each bank only the rows 
+                  inside the rectangle are touched, using a mask computed for the top and the 
+                  bottom bank. Coordinates outside the screen are clipped.
+  Argument(s)  :  x1, y1, x2, y2 -> Absolute coordinates of 2 opposite corners (inclusive)
+                  pixel_mode -> PIXEL_ON, PIXEL_OFF, PIXEL_XOR
+  Return value :  None.
+--------------------------------------------------------------------------------------------------*/
+void dFillRect ( uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t pixel_mode )
+{
+	uint8_t t, bank, lastbank, mask, x;
+	uint8_t * ptr;
+
+	if ( x1 > x2 ) { t = x1; x1 = x2; x2 = t; }
+	if ( y1 > y2 ) { t = y1; y1 = y2; y2 = t; }
+	if ( x1 >= X_RES || y1 >= Y_RES ) return;
+	if ( x2 >= X_RES ) x2 = X_RES - 1;
+	if ( y2 >= Y_RES ) y2 = Y_RES - 1;
+
+	lastbank = y2 / 8;
+	for ( bank = y1 / 8; bank <= lastbank; bank++ )
+	{
+		mask = 0xff;
+		if ( bank == y1 / 8 )
+			mask &= 0xff << (y1 % 8);
+		if ( bank == lastbank )
+			mask &= 0xff >> (7 - y2 % 8);
+
+		ptr = &LCD.Cache[bank * X_RES + x1];
+		x = x2 - x1 + 1;
+		switch ( pixel_mode ) {
+			case PIXEL_ON:  do { *ptr++ |=  mask; } while ( --x ); break;
+			case PIXEL_OFF: do { *ptr++ &= ~mask; } while ( --x ); break;
+			case PIXEL_XOR: do { *ptr++ ^=  mask; } while ( --x ); break;
+			default: return;
+		}
+		dDirty( bank, x1, x2 );
+	}
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Names        :  dHLine & dVLine
+  Description  :  Horizontal and vertical lines, drawn with dFillRect.
+  Argument(s)  :  x1, x2, y / x, y1, y2 -> Absolute pixel coordinates
+                  pixel_mode -> PIXEL_ON, PIXEL_OFF, PIXEL_XOR
+  Return value :  None.
+--------------------------------------------------------------------------------------------------*/
+void dHLine ( uint8_t x1, uint8_t x2, uint8_t y, uint8_t pixel_mode )
+{
+	dFillRect( x1, y, x2, y, pixel_mode );
+}
+
+void dVLine ( uint8_t x, uint8_t y1, uint8_t y2, uint8_t pixel_mode )
+{
+	dFillRect( x, y1, x, y2, pixel_mode );
+}
+
+/*--------------------------------------------------------------------------------------------------
+  Name         :  dInvert
+  Description  :  Inverts the pixels of a region (e.g. to highlight a menu entry).
+  Argument(s)  :  x1, y1, x2, y2 -> Absolute coordinates of 2 opposite corners (inclusive)
+  Return value :  None.
+--------------------------------------------------------------------------------------------------*/
+void dInvert ( uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2 )
+{
+	dFillRect( x1, y1, x2, y2, PIXEL_XOR );
 }
 
 /*--------------------------------------------------------------------------------------------------
@@ -399,7 +673,6 @@ void dPixel( uint8_t x, uint8_t y, LcdPixelMode mode )
 --------------------------------------------------------------------------------------------------*/
 void dRectangle	 ( uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t pixel_mode, uint8_t linewidth)
 {
-	uint16_t i,j;
 	uint8_t newx1,newx2,newy1,newy2;
 
 	// if 1-D rectangle
@@ -416,15 +689,17 @@ void dRectangle	 ( uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t pixel
 	y1 = newy1;
 	y2 = newy2;
 	
-	// draw rectangle pixel by pixel (!! should improve this; in certain situations it can be drawn by filling octets in cache)
-	for ( j=x1; j<=x2; j++ )
-		for ( i=y1; i<=y2; i++ )
-			dPixel(j,i,pixel_mode);
-
 	// if a linewidth is provided and it's a valid one
 	if ( linewidth > 0 && ( linewidth <= min( x2-x1, y2-y1 )/2 ))
-		// draw an inner rectangle using PIXEL_XOR mode to extrude from the outer one.
-		dRectangle( x1 + linewidth, y1 + linewidth, x2 - linewidth, y2 - linewidth, PIXEL_XOR, 0 );	
+	{
+		// draw the 4 borders without overlapping, so PIXEL_XOR works too
+		dFillRect( x1, y1, x2, y1 + linewidth - 1, pixel_mode );
+		dFillRect( x1, y2 - linewidth + 1, x2, y2, pixel_mode );
+		dFillRect( x1, y1 + linewidth, x1 + linewidth - 1, y2 - linewidth, pixel_mode );
+		dFillRect( x2 - linewidth + 1, y1 + linewidth, x2, y2 - linewidth, pixel_mode );
+	}
+	else
+		dFillRect( x1, y1, x2, y2, pixel_mode );
 }
 
 // Dummy char comparision function
@@ -459,6 +734,18 @@ void dLine       ( uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t pixel
 	int16_t stepx, stepy, fraction;
 	// error handling
 	if ( x1 >= X_RES || y1 >= Y_RES || x2 >= X_RES || y2 >= Y_RES ) return; 
+
+	// axis aligned lines are filled byte-wise
+	if ( y1 == y2 )
+	{
+		dHLine( x1, x2, y1, pixel_mode );
+		return;
+	}
+	if ( x1 == x2 )
+	{
+		dVLine( x1, y1, y2, pixel_mode );
+		return;
+	}
 	
 	int16_t dy = y2-y1;
 	int16_t dx = x2-x1;
@@ -6,13 +6,27 @@
 #ifndef _LPH7366_H_
 	#define _LPH7366_H_
 
+#include <stdint.h>
+#ifndef LCD_HOST
 #include <avr/pgmspace.h>
+#else
+/* Linux build for tools/lcdemu: flash is plain memory, the bytes go to a PCD8544 emulator */
+#include <string.h>
+#define PROGMEM
+#define PSTR(s)				(s)
+#define pgm_read_byte(p)	(*(const uint8_t *)(p))
+#define pgm_read_word(p)	(*(const uint16_t *)(p))
+#define memcpy_P			memcpy
+#endif
 
 /*--------------------------------------------------------------------------------------------------
                                   Library submodules
 --------------------------------------------------------------------------------------------------*/
 #define LCD_with_TEXT
 #define LCD_with_GRAPHICS
+#ifndef LCD_HOST
+#define LCD_with_ASYNC		// interrupt driven refresh (dRefreshAsync)
+#endif
 
 /*--------------------------------------------------------------------------------------------------
                            General purpose constants and operations
@@ -26,6 +40,12 @@
 #define MOSI_PIN               0x08  //  PB3
 #define RST_PIN                0x01  //  PD0
 #define CLK_PIN                0x20  //  PB5
+#define SS_PIN                 0x04  //  PB2, must be an output in SPI master mode
+
+// The PCD8544 serial interface is specified up to 4 Mbit/s
+#define LCD_SPI_MAX_HZ			4000000UL
+// Refresh rate limit of dService, the panel does not show changes much faster anyway
+#define LCD_MAX_FPS				10
 
 #define set_LCD_DC		(PORTD |= DC_PIN)
 #define set_LCD_CE		(PORTD |= CE_PIN)
@@ -53,10 +73,18 @@ typedef enum {
 typedef struct  {
 	 uint8_t  Cache [ LCD_CACHE_SIZE ];
 	 int16_t  idx;
-	 int16_t  lidx;
-	 int16_t  hidx;
+	 uint8_t  lo [ LCD_LINES ];		// first dirty column of each bank
+	 uint8_t  hi [ LCD_LINES ];		// last dirty column of each bank, lo > hi if clean
+	 uint8_t  mirror;				// banks changed since mirror.c last sent them, bit n = bank n
 } LCD_t;
 
+extern LCD_t LCD;
+
+#ifdef LCD_HOST
+// Provided by the host program, receives every byte the driver would shift out on SPI
+void lcdHostSend ( uint8_t data, uint8_t cd );
+#endif
+
 /*--------------------------------------------------------------------------------------------------
                                  Public function prototypes
                                  
@@ -66,7 +94,14 @@ void initLCD     ( void );
 void dContrast   ( uint8_t contrast );
 void dClear      ( void );
 void dRefresh    ( void );
+#ifdef LCD_with_ASYNC
+void dRefreshAsync ( void );
+uint8_t dBusy    ( void );
+#endif
+void dService    ( void );
+void dUrgent     ( void );
 int16_t dCachepos ( uint8_t x, uint8_t y );
+void dDirty      ( uint8_t bank, uint8_t x1, uint8_t x2 );
 uint8_t dPixelIsSet( uint8_t x, uint8_t y );
 
 #ifdef LCD_with_TEXT
@@ -75,12 +110,19 @@ void dChar  	 ( uint8_t ch );
 void dText       ( uint8_t *dataPtr );
 void dText_FF    ( const int8_t *dataPtr );
 #define dText_P(conststr)  ( dText_FF(PSTR(conststr)) )
+void dColumn     ( uint8_t x, uint8_t y, const uint8_t *bytes, uint8_t n );
+uint8_t dCharAt   ( uint8_t x, uint8_t y, uint8_t ch, uint8_t scale );
+uint16_t dTextAt  ( uint8_t x, uint8_t y, const char *string, uint8_t scale );
 #endif
 
 #ifdef LCD_with_GRAPHICS
 void dPixel      ( uint8_t x, uint8_t y, LcdPixelMode mode );
 void dLine       ( uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t pixel_mode, uint8_t linewidth );
 void dRectangle	 ( uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2 , uint8_t pixel_mode, uint8_t linewidth );
+void dFillRect   ( uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t pixel_mode );
+void dHLine      ( uint8_t x1, uint8_t x2, uint8_t y, uint8_t pixel_mode );
+void dVLine      ( uint8_t x, uint8_t y1, uint8_t y2, uint8_t pixel_mode );
+void dInvert     ( uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2 );
 #endif
 
 #endif  //  _LPH7366_H_
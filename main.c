@@ -2,17 +2,30 @@
 #include <stdint.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
-// #include <avr/pgmspace.h>
+#include <avr/pgmspace.h>
 #include "utils.h"
 #include "timer1.h"
-#include "rc5.h"
+#include "ir.h"
+#include "keys.h"
 #include "fifo.h"
 #include "lph7366.h"
 #include "dht22.h"
 #include "backlight.h"
 #include "timer0.h"
+#include "adc.h"
 #include "mg811.h"
+#include "mg811cal.h"
+#include "console.h"
+#include "chart.h"
+#include "ui.h"
+#include "mirror.h"
 #include "uart.h"
+#include "font.h"
+#include "humidity.h"
+#include "vent.h"
+#include "relay.h"
+#include "rtc.h"
+#include "schedule.h"
 
 #define OFF		0
 #define UART_DEBUG	1	
@@ -20,9 +33,10 @@
 #define DEBUG		UART_DEBUG
 
 
-extern fifoType rc5buffer;
-void checkIR(void);
-void rc5store(uint16_t);
+void checkIR(const irEvent_Type *);
+void checkKey(const keyEvent_Type *);
+void updateChart(void);
+void updateDashboard(void);
 
 static FILE uartstream = FDEV_SETUP_STREAM(uartSendChar, uartGet, _FDEV_SETUP_RW);
 
@@ -34,19 +48,25 @@ int main(void)
 	// configure printf, scanf etc. for USART
 	stdout = stdin = &uartstream; 
 
-	// Relays
-	sbi(DDRD,6); sbi(PORTD,6);
-	sbi(DDRD,7); sbi(PORTD,7);
+	// Relays, all off
+	relayInit();
 
 	// initial state of the ICP
 	cbi(DHT22_DIR, DHT22_PIN);
 	sbi(DHT22_PORT, DHT22_PIN);
 
 	initMG811();
+	humidityInit();
+	ventInit();
+	rtcInit();
+	scheduleInit();
+	initADC();
+	chartInit();
 
 	initTimer0();
 	initTimer1();
-	rc5init(rc5store, RC5_INVERTED); // Enable user control
+	keyInit(checkKey);
+	irInit(checkIR, IR_INVERTED); // Enable user control
 
 	// LCD related
 #if (DEBUG != UART_DEBUG)
@@ -55,11 +75,14 @@ int main(void)
 	dContrast(0x35);
 	
 	dClear();
-	dCursor(0,0);
-	dText("Reset");
+	uiDraw();
+	chartShow(CHART_CO2);
 	dRefresh();
 #else
 	initUART();
+	// No panel on this build, the dashboard is still drawn in the cache for the "lcd" mirror
+	uiDraw();
+	chartShow(CHART_CO2);
 #endif
 
 	// Enable interrupts in SREG.I
@@ -67,7 +90,19 @@ int main(void)
 
 	while(1)
 	{
-		checkIR();
+		irService();
+		keyService();
+#if (DEBUG == UART_DEBUG)
+		consolePoll();
+		mirrorService();
+#else
+		dService();
+		backlightService();
+#endif
+
+		// Setpoints of the time of day, not before the clock knows it
+		if( rtcService() && rtcState() != RTC_UNSET )
+			scheduleTick(rtcDay(), rtcMinute());
 		
 		if( DHT22_State() == DHT22_READY )
 		{
@@ -78,6 +113,7 @@ int main(void)
 			//dCursor(3,0);
 			//dText(string);
 			//dRefresh();
+			humiditySample(DHT22_ReadHumidity() * 10);
 			printf("\nT: %.1f", DHT22_ReadTemperature());
 			printf("\nH: %.1f", DHT22_ReadHumidity());
 		}
@@ -85,11 +121,18 @@ int main(void)
 		if(OneSecondFlag)
 		{
 			DHT22_Read();
-			printf("CO2Curve %f %f %f", CO2Curve[0], CO2Curve[1], CO2Curve[2]);
-			float mg811volts = MG811_ReadVolts();
-			printf("\nCO2: %.2f V", mg811volts);
-			uint32_t mg811ppm = MG811_ReadPPM( mg811volts, CO2Curve );
-			printf("\nCO2: %u ppm", mg811ppm);
+			MG811_CalTick();
+			MG811_Update();
+			humidityTick();
+			printf("\nHum: state %u pump %u run %u s", humidityStatus()->state, humidityStatus()->relay, humidityStatus()->runTime);
+			ventTick();
+			printf("\nVent: state %u relay %u duty %u", ventStatus()->state, ventStatus()->relay, ventStatus()->duty);
+			relayTick();
+			printf("\nCO2: %.2f V", MG811_ReadVolts());
+			printf("\nCO2: %u ppm", MG811_ReadPPM());
+			printf("\nSoil: %u Light: %u Vcc: %u mV", adcRead(ADC_SOIL), adcRead(ADC_LIGHT), adcVcc());
+			updateChart();
+			updateDashboard();
 			//i+=10;
 			//dContrast(i);
 			//sprintf(string, "CO2: %u", readMG811());
@@ -105,71 +148,141 @@ int main(void)
 }
 
 /**--------------------------------------------------------------------------------------------------
-  Description  :  Store the command to the rc5buffer circular buffer and filter repetitive commands.
-				  This function is called by the rc5 library after successfull decoding.
+  Description  :  Called by irService() in the main loop for every remote control frame. Shows the
+				  codes of any remote on the UART, which helps to add one to keyRemotes and keyMap.
 --------------------------------------------------------------------------------------------------**/
-// 
-void rc5store(uint16_t data)
+void checkIR(const irEvent_Type * ev)
 {
-	uint8_t command = rc5comm(data);
-	static uint8_t prevtogglebit;
-	
-	// exceptions of buttons who can be continuously pressed
-	if(command != CHUP && command != CHDOWN)
-	{
-		// Take care of long press of a button
-		uint8_t currtogglebit = rc5tog(data);
-	
-		if(prevtogglebit == currtogglebit)
-			return;
-		prevtogglebit = currtogglebit;	
-	}
+#if (DEBUG == UART_DEBUG)
+	printf("\nIR: %u %u %u", ev->protocol, ev->address, ev->command);
+#endif
+	keyIr(ev);
+}
 
-	fifoWrite(&rc5buffer, (int8_t)command);	
+static void togglePower(void)
+{
+	if( getBacklight() ) 
+		setBacklight(0);
+	else
+		setBacklight(7);
 }
 
+static void toggleHumidity(void) { humidityEnable(humidityStatus()->state == HUM_DISABLED); }
+static void toggleVent(void) { ventEnable(ventStatus()->state == VENT_DISABLED); }
+static void startCalibration(void) { MG811_CalStart(); }
+static void startLearning(void) { keyLearn(KEY_POWER, 1); }
+
+typedef void (*actionType)(void);
+
+// Action of every key, indexed by keyId_Type. NULL does nothing.
+static const actionType keyActions[KEYS] PROGMEM = {
+	[KEY_POWER] = togglePower,
+	[KEY_MENU] = startCalibration,
+	[KEY_AV] = startLearning,
+	[KEY_CHUP] = incrBacklight,
+	[KEY_CHDOWN] = decrBacklight,
+	[KEY_1] = DHT22_Read,
+	[KEY_2] = toggleHumidity,
+	[KEY_3] = toggleVent,
+};
+
 /**--------------------------------------------------------------------------------------------------
-  Description  :  Called in the main loop. Checks the FIFO for new commands and executes corresponding 
-				  actions.
+  Description  :  Called by the key layer in the main loop. Executes the action of a key on its 
+				  press, and again on every hold event for the keys that repeat (see keyInfo).
+				  In learning mode shows the key to press on the top line of the LCD. A key that 
+				  wakes the dimmed backlight does nothing else, neither do its hold events.
 --------------------------------------------------------------------------------------------------**/
-void checkIR(void)
+void checkKey(const keyEvent_Type * ev)
 {
-	uint8_t command;
+	static uint8_t waking;
+	actionType action;
+
+	// keyActions[] has KEYS entries, the key may come from an EEPROM record
+	if( ev->action == KEY_RELEASE || ev->key >= KEYS )
+		return;
 
-	if( !fifoIsEmpty(&rc5buffer) )
+	if( ev->action == KEY_PRESS )
+		waking = backlightWake();
+	else if( ev->action == KEY_LEARN )
+		backlightWake();
+	if( waking && ev->action != KEY_LEARN )
+		return;
+
+	if( ev->action == KEY_LEARN )
 	{
-		fifoRead(&rc5buffer, (int8_t *)&command);
+#if (DEBUG != UART_DEBUG)
+		dFillRect(0, 0, X_RES-1, 7, PIXEL_OFF);
+		if( ev->key != KEY_NONE )
+		{
+			fontSelect(&Font5x7, 1);
+			fontText_P(fontText_P(0, 0, PSTR("Press ")), 0, keyName(ev->key));
+		}
+		else
+			uiDraw();
+#endif
+		return;
+	}
+
 #if (DEBUG == LCD_DEBUG)
-		dCursor(0,0);
-		char debugstr[6];
-		sprintf(debugstr, "C:%d", command);
-		dText(debugstr);
-		dRefresh();
+	dCursor(0,0);
+	char debugstr[6];
+	sprintf(debugstr, "K:%d", ev->key);
+	dText(debugstr);
+	dUrgent();
 #endif
-		switch (command) {
-			case CHUP: 
-				incrBacklight(); 
-			break;
-
-			case CHDOWN: 
-				decrBacklight(); 
-			break;
-
-			case POWER: 
-				if( getBacklight() ) 
-					setBacklight(0);
-				else
-					setBacklight(7);
-			break;
-
-			case 2: tbi(PORTD,6); break;
-			case 3: tbi(PORTD,7); break;
-			case 1: DHT22_Read(); break;	 
-		}
+	action = (actionType)pgm_read_word(&keyActions[ev->key]);
+	if( action )
+		action();
+}
 
-		
+/**--------------------------------------------------------------------------------------------------
+  Description  :  Called once a second. Adds a sample of every series to the trend chart each
+				  CHART_PERIOD seconds.
+--------------------------------------------------------------------------------------------------**/
+void updateChart(void)
+{
+	static uint8_t seconds;
+	DHT22_Info_Type dht;
+	uint16_t ppm;
+
+	if( ++seconds < CHART_PERIOD )
+		return;
+	seconds = 0;
+
+	ppm = MG811_ReadPPM();
+	if( ppm == MG811_PPM_INVALID )
+		chartPushMissing(CHART_CO2);
+	else
+		chartPush(CHART_CO2, ppm);
+	// DHT22_Last, not the Read functions: those end the transfer started this second.
+	// A reading older than the humidity controller accepts is missing here too.
+	if( DHT22_Last(&dht) <= HUM_STALE )
+	{
+		chartPush(CHART_TEMPERATURE, dht.Temperature * 10);
+		chartPush(CHART_HUMIDITY, dht.Humidity * 10);
+	}
+	else
+	{
+		chartPushMissing(CHART_TEMPERATURE);
+		chartPushMissing(CHART_HUMIDITY);
 	}
 }
 
+/**--------------------------------------------------------------------------------------------------
+  Description  :  Called once a second. Passes the current readings to the dashboard, which only
+				  repaints the widgets that changed. dService (or the mirror) sends them with the next frame.
+--------------------------------------------------------------------------------------------------**/
+void updateDashboard(void)
+{
+	DHT22_Info_Type dht;
+	uint16_t ppm = MG811_ReadPPM();
+	uint8_t valid = DHT22_Last(&dht) <= HUM_STALE;
 
-
+	uiSet(UI_CO2, ppm == MG811_PPM_INVALID ? UI_NODATA : (int16_t)ppm);
+	uiSet(UI_TEMPERATURE, valid ? dht.Temperature * 10 : UI_NODATA);
+	uiSet(UI_HUMIDITY, valid ? dht.Humidity : UI_NODATA);
+	uiSet(UI_RELAY1, relayState(RELAY_PUMP));
+	uiSet(UI_RELAY2, relayState(RELAY_VENT));
+	uiSet(UI_SOIL, adcRead(ADC_SOIL));
+	uiSet(UI_LIGHT, adcRead(ADC_LIGHT));
+}
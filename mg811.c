@@ -10,77 +10,96 @@
 
 #include <stdint.h>
 #include <avr/io.h> 
-#include <math.h>
+#include <avr/pgmspace.h>
+#include "adc.h"
 #include "mg811.h"
+#include "mg811cal.h"
+#include "mg811lut.h"
+#include "filter.h"
 
-float CO2Curve[3]  =  { 2.602, ZERO_POINT_VOLTAGE, (REACTION_VOLTGAE / ( 2.602 - 3 )) };
+MG811_Curve_Type CO2Curve;
+
+static filterEMA_Type co2filter;
+static uint16_t co2code;
 
 /**------------------------------------------------------------------------------------------------
-  Description : 	Initialize ADC
+  Description : 	Load the calibration. Sampling is done by the ADC scheduler (adc.c).
 -------------------------------------------------------------------------------------------------**/
 void initMG811()
 {
-	// disable digital function
-	DIDR0 = 0xff;
-	// AVCC reference, channel 0
-	ADMUX =  (1<<REFS0) ;
-	// 128 prescaler => 125 kHz
-	ADCSRA = (1<<ADEN) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0); 
-	// Free running mode
-	ADCSRB = 0;
-	
-	// dummy read
-	ADCSRA |= (1<<ADSC); 
+	MG811_SetCurve(MG811_ZERO_CODE, MG811_SLOPE_CODE);
+	MG811_CalLoad();
+	filterEMAInit(&co2filter, MG811_EMA_SHIFT);
 }
 
 /**------------------------------------------------------------------------------------------------
-  Description 	: 	Reads ADC channel 0
-  Return		: 	0-1024
+  Description 	: 	outputs the averaged, oversampled ADC reading as a voltage. Does not block.
+  Return		: 	voltage as float
 -------------------------------------------------------------------------------------------------**/
-static uint16_t MG811_ReadADC(void)
+float MG811_ReadVolts(void)
 {
-	uint16_t retval = 0;
-	ADCSRA |= (1<<ADSC); 
-	while( ADCSRA & (1<<ADSC) )
-		;
-	retval = ADCL;
-	retval |= ((uint16_t)ADCH<<8);
-
-	return retval;
+	return (float)adcAverage() * MG811_VREF / ADC_FULL_SCALE;
 }
 
-/**------------------------------------------------------------------------------------------------
-  Description 	: 	reads samples and outputs an average voltage
-  Return		: 	voltage as float
+/**-------------------------------------------------------------------------------------------------
+  Description 	: 	Sets the sensor curve used by MG811_CodeToPPM. The table in flash does not 
+					depend on the sensor, so a new calibration only costs this division.
+  Arguments		:	zero - ADC code at 400 ppm
+					slope - ADC codes per decade of concentration, more than MG811_LUT_STEPS
+					so that scale fits in 16 bits
+  Return		: 	1 if the curve was set, 0 if the slope was rejected
 -------------------------------------------------------------------------------------------------**/
-float MG811_ReadVolts(void)
+uint8_t MG811_SetCurve(uint16_t zero, uint16_t slope)
 {
-	int i;
-	float v=0;
-
-	for ( i=0; i<READ_SAMPLE_TIMES; i++ ) 
-	{
-		v += MG811_ReadADC();
-		delay_ms(READ_SAMPLE_INTERVAL);
-    }
-	v = ( v / READ_SAMPLE_TIMES ) * 3.3 / 1024 ;
+	if ( slope <= MG811_LUT_STEPS ) return 0;
 
-	return v;  
+	CO2Curve.zero = zero;
+	CO2Curve.slope = slope;
+	CO2Curve.scale = ((uint32_t)MG811_LUT_STEPS << 16) / slope;
+	return 1;
 }
 
 /**-------------------------------------------------------------------------------------------------
   Description 	: 	By using the slope and a point of the line. The x(logarithmic value of ppm) 
          			of the line could be derived if y (MG-811 output) is provided. As it is a 
-         			logarithmic coordinate, power of 10 is used to convert the result to 
-					non-logarithmic value.
-  Arguments		:	volts - ADC measuring in volts
-					pcurve - pointer to the curve of the CO2
-  Return		: 	ppm 
+         			logarithmic coordinate, the power of 10 is read from MG811_Lut and linearly
+					interpolated (error < 0.3% against pow(), see tools/mg811lut.c -c).
+  Arguments		:	code - oversampled ADC reading
+  Return		: 	ppm, saturating at the end of the table, or MG811_PPM_INVALID more than
+					MG811_ZERO_MARGIN codes above the 400 ppm point
+-------------------------------------------------------------------------------------------------**/
+uint16_t MG811_CodeToPPM(uint16_t code)
+{
+	uint32_t pos;
+	uint16_t idx, lo, hi;
+
+	if ( code >= CO2Curve.zero ) 
+		return ( code - CO2Curve.zero <= MG811_ZERO_MARGIN ) ? pgm_read_word( &MG811_Lut[0] ) : MG811_PPM_INVALID;
+
+	// position in the table, 8 fractional bits
+	pos = ((uint32_t)(CO2Curve.zero - code) * CO2Curve.scale) >> 8;
+	idx = pos >> 8;
+	if ( idx >= MG811_LUT_SIZE - 1 )
+		return pgm_read_word( &MG811_Lut[MG811_LUT_SIZE - 1] );
+
+	lo = pgm_read_word( &MG811_Lut[idx] );
+	hi = pgm_read_word( &MG811_Lut[idx + 1] );
+	return lo + (((uint32_t)(hi - lo) * (uint8_t)pos) >> 8);
+}
+
+/**-------------------------------------------------------------------------------------------------
+  Description 	: 	Feeds the averaged ADC reading to the low-pass filter. Call once per second.
+-------------------------------------------------------------------------------------------------**/
+void MG811_Update(void)
+{
+	co2code = filterEMA( &co2filter, adcAverage() );
+}
+
+/**-------------------------------------------------------------------------------------------------
+  Description 	: 	CO2 concentration of the filtered reading (see MG811_Update)
+  Return		: 	ppm or MG811_PPM_INVALID
 -------------------------------------------------------------------------------------------------**/
-uint32_t MG811_ReadPPM(float volts, float * pcurve)
+uint16_t MG811_ReadPPM(void)
 {
-	if ( ( volts / DC_GAIN ) >= ZERO_POINT_VOLTAGE ) 
-		return -1;
-	else 
-		return pow( 10, ( ( volts / DC_GAIN )- pcurve[1] ) / pcurve[2] + pcurve[0] );
+	return MG811_CodeToPPM( co2code );
 }
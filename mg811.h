@@ -2,23 +2,44 @@
 #define MG811_H
 
 #include <stdint.h>
+#include "adc.h"
 
 #define DC_GAIN (8.5)   // DC gain of the amplifier
 
-/* Software Related Macros */
-#define		READ_SAMPLE_INTERVAL		(10)    // number of samples
-#define		READ_SAMPLE_TIMES			(1)     // time interval between samples
+/* Hardware Related Macros */
+#define		MG811_VREF				(3.3)	// ADC reference voltage (AVCC)
 
 /* Application Related Macros */
 /* These two values differ from sensor to sensor. User should derermine this value. */
 #define		ZERO_POINT_VOLTAGE		(0.220) 	// sensor output in volts when the concentration of CO2 is 400PPM
 #define		REACTION_VOLTGAE		(0.020) 	// voltage drop of the sensor when moving it into 1000ppm medium
 
-/* Gas characteristic */
-extern float CO2Curve[3]; 
+/* Gas characteristic expressed in ADC codes (ADC_RESOLUTION bits) */
+#define		MG811_ZERO_CODE			((uint16_t)(ZERO_POINT_VOLTAGE * DC_GAIN * ADC_FULL_SCALE / MG811_VREF + 0.5))
+#define		MG811_SLOPE_CODE		((uint16_t)(REACTION_VOLTGAE / (3 - 2.602) * DC_GAIN * ADC_FULL_SCALE / MG811_VREF + 0.5))
+
+// Time constant of the low-pass filter applied by MG811_Update, about 2^MG811_EMA_SHIFT seconds
+#define		MG811_EMA_SHIFT			2
+
+// Returned by MG811_ReadPPM when the output is above the 400 ppm point by more than the noise.
+// The fresh air calibration puts the zero on the mean reading, so half of the readings in fresh
+// air are above it: up to MG811_ZERO_MARGIN codes above the zero still read 400 ppm.
+#define		MG811_PPM_INVALID		0xFFFF
+#define		MG811_ZERO_MARGIN		8
+
+typedef struct {
+	uint16_t zero;		// ADC code at 400 ppm
+	uint16_t slope;		// ADC codes per decade of concentration (the output drops as ppm rises)
+	uint16_t scale;		// table steps per ADC code, Q16 - derived by MG811_SetCurve
+} MG811_Curve_Type;
+
+extern MG811_Curve_Type CO2Curve; 
 
 void initMG811(void);
 float MG811_ReadVolts(void);
-uint32_t MG811_ReadPPM(float volts, float * pcurve);
+uint8_t MG811_SetCurve(uint16_t zero, uint16_t slope);
+uint16_t MG811_CodeToPPM(uint16_t code);
+void MG811_Update(void);
+uint16_t MG811_ReadPPM(void);
 
 #endif
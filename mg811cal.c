@@ -0,0 +1,133 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	MG811 calibration. The curve (ADC code at 400 ppm and codes per decade) is kept in 
+			EEPROM so a replaced sensor only needs a fresh air calibration, not a new firmware.
+			The baseline capture is started from the remote control (MENU) or the UART ("cal air")
+			and is only accepted once the heater has warmed up.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "adc.h"
+#include "nvm.h"
+#include "console.h"
+#include "mg811.h"
+#include "mg811cal.h"
+
+static MG811_CalState_Type calstate = MG811_WARMUP;
+static uint16_t seconds;
+static uint16_t reference;
+static uint32_t sum;
+static uint8_t count;
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Loads the stored curve. Keeps the compile time defaults if there is none.
+-------------------------------------------------------------------------------------------------**/
+void MG811_CalLoad(void)
+{
+	MG811_CalRecord_Type record;
+
+	if ( nvmLoad(NVM_MG811_CAL, &record, sizeof(record), MG811_CAL_VERSION) )
+		MG811_SetCurve(record.zero, record.slope);
+}
+
+static void MG811_CalSave(void)
+{
+	MG811_CalRecord_Type record;
+
+	record.zero = CO2Curve.zero;
+	record.slope = CO2Curve.slope;
+	nvmSave(NVM_MG811_CAL, &record, sizeof(record), MG811_CAL_VERSION);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Warm-up detection and baseline capture. Call once per second.
+-------------------------------------------------------------------------------------------------**/
+void MG811_CalTick(void)
+{
+	uint16_t code = adcAverage();
+
+	switch ( calstate ) {
+		case MG811_WARMUP:
+			if ( ++seconds % 60 )
+				break;
+			if ( seconds >= MG811_WARMUP_MIN && abs((int16_t)(code - reference)) <= MG811_WARMUP_DRIFT )
+				calstate = MG811_IDLE;
+			reference = code;
+		break;
+
+		case MG811_CALIBRATING:
+			sum += code;
+			if ( ++count == MG811_CAL_SECONDS )
+			{
+				MG811_SetCurve(sum / MG811_CAL_SECONDS, CO2Curve.slope);
+				MG811_CalSave();
+				calstate = MG811_IDLE;
+				printf_P(PSTR("\nCAL: zero %u"), CO2Curve.zero);
+			}
+		break;
+
+		default:
+		break;
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Starts the fresh air baseline capture. The sensor must be at 400 ppm during
+					the next MG811_CAL_SECONDS.
+  Return		: 	1 if started, 0 if the sensor is warming up or a capture is in progress
+-------------------------------------------------------------------------------------------------**/
+uint8_t MG811_CalStart(void)
+{
+	if ( calstate != MG811_IDLE )
+		return 0;
+
+	sum = 0;
+	count = 0;
+	calstate = MG811_CALIBRATING;
+	return 1;
+}
+
+MG811_CalState_Type MG811_CalState(void)
+{
+	return calstate;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Console command
+					cal				- show the curve and the calibration state
+					cal air			- capture the 400 ppm baseline
+					cal warm		- skip warm-up detection
+					cal slope <n>	- set the codes per decade and save
+					cal default		- restore and save the compile time curve
+-------------------------------------------------------------------------------------------------**/
+void MG811_CalCommand(char * args)
+{
+	char * value = consoleNextArg(args);
+
+	if ( !strcmp_P(args, PSTR("air")) )
+	{
+		if ( !MG811_CalStart() )
+			printf_P(PSTR("\nCAL: busy"));
+	}
+	else if ( !strcmp_P(args, PSTR("warm")) )
+	{
+		if ( calstate == MG811_WARMUP )
+			calstate = MG811_IDLE;
+	}
+	else if ( !strcmp_P(args, PSTR("slope")) )
+	{
+		if ( MG811_SetCurve(CO2Curve.zero, atoi(value)) )
+			MG811_CalSave();
+		else
+			printf_P(PSTR("\nCAL: slope too low"));
+	}
+	else if ( !strcmp_P(args, PSTR("default")) )
+	{
+		MG811_SetCurve(MG811_ZERO_CODE, MG811_SLOPE_CODE);
+		MG811_CalSave();
+	}
+
+	printf_P(PSTR("\nCAL: state %u zero %u slope %u"), calstate, CO2Curve.zero, CO2Curve.slope);
+}
@@ -0,0 +1,35 @@
+#ifndef MG811CAL_H
+#define MG811CAL_H
+
+#include <stdint.h>
+
+/* The heater needs a few minutes to stabilize. The sensor is considered warm when its 
+   reading moved less than MG811_WARMUP_DRIFT codes during the last minute, but never 
+   before MG811_WARMUP_MIN seconds. */
+#define MG811_WARMUP_MIN		300
+#define MG811_WARMUP_DRIFT		4
+
+// Number of one second readings averaged for the fresh air (400 ppm) baseline
+#define MG811_CAL_SECONDS		30
+
+// Increment when the layout of MG811_CalRecord_Type changes
+#define MG811_CAL_VERSION		1
+
+typedef struct {
+	uint16_t zero;
+	uint16_t slope;
+} MG811_CalRecord_Type;
+
+typedef enum {
+	MG811_WARMUP,
+	MG811_IDLE,
+	MG811_CALIBRATING
+} MG811_CalState_Type;
+
+void MG811_CalLoad(void);
+void MG811_CalTick(void);
+uint8_t MG811_CalStart(void);
+MG811_CalState_Type MG811_CalState(void);
+void MG811_CalCommand(char * args);
+
+#endif
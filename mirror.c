@@ -0,0 +1,134 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	LCD mirror on the UART. dDirty sets a bit in LCD.mirror for every bank that changes,
+			so a frame only carries the banks changed since the previous one (or all of them
+			for a full frame). mirrorService() sends at most one bank per call and only when
+			the transmit buffer has room for the whole packet, so it never blocks the main loop.
+			A blank bank takes 7 bytes on the wire.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <avr/pgmspace.h>
+#include "uart.h"
+#include "timer0.h"
+#include "lph7366.h"
+#include "mirror.h"
+
+#define MIRROR_ALL		((1 << LCD_LINES) - 1)
+
+static uint16_t period;			// ms between two frames, 0 = only on request
+static uint32_t lastFrame;
+static uint8_t pending;			// banks of the current frame not sent yet
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Run length encodes one bank (see mirror.h)
+  Argument(s)	:	src -> first byte of the bank, sum -> checksum to update, NULL to only count
+  Return		: 	encoded length
+-------------------------------------------------------------------------------------------------**/
+static uint8_t mirrorEncode(const uint8_t * src, uint8_t * sum)
+{
+	uint8_t i = 0, n, k, len = 0, b;
+
+	while ( i < X_RES )
+	{
+		// Run of equal bytes
+		n = 1;
+		while ( i + n < X_RES && n < 129 && src[i + n] == src[i] )
+			n++;
+		if ( n >= 2 )
+		{
+			if ( sum )
+			{
+				b = 0x80 | (n - 2);
+				uartSendByte(b);
+				uartSendByte(src[i]);
+				*sum += b + src[i];
+			}
+			len += 2;
+			i += n;
+			continue;
+		}
+
+		// Literals up to the next run of three or the end of the bank
+		n = 1;
+		while ( i + n < X_RES && n < 128 &&
+				!( i + n + 2 < X_RES && src[i + n] == src[i + n + 1] && src[i + n] == src[i + n + 2] ) )
+			n++;
+		if ( sum )
+		{
+			uartSendByte(n - 1);
+			*sum += n - 1;
+			for ( k = 0; k < n; k++ )
+			{
+				uartSendByte(src[i + k]);
+				*sum += src[i + k];
+			}
+		}
+		len += n + 1;
+		i += n;
+	}
+	return len;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Queues a frame with every bank
+-------------------------------------------------------------------------------------------------**/
+void mirrorFrame(void)
+{
+	pending = MIRROR_ALL;
+	LCD.mirror = 0;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Called from the main loop. Starts a frame of the changed banks every period
+					ms and sends the next bank of the current frame.
+-------------------------------------------------------------------------------------------------**/
+void mirrorService(void)
+{
+	const uint8_t * src;
+	uint8_t bank, len, sum;
+
+	if ( !pending )
+	{
+		if ( !period || getTicks() - lastFrame < period )
+			return;
+		lastFrame = getTicks();
+		pending = LCD.mirror;
+		LCD.mirror = 0;
+		if ( !pending )
+			return;
+	}
+
+	if ( uartTxFree() < MIRROR_PACKET_MAX )
+		return;
+
+	for ( bank = 0; !(pending & (1 << bank)); bank++ )
+		;
+	pending &= ~(1 << bank);
+	src = &LCD.Cache[bank * X_RES];
+
+	len = mirrorEncode(src, NULL);
+	if ( !pending )
+		bank |= MIRROR_LAST;
+	uartSendByte(MIRROR_SYNC);
+	uartSendByte(MIRROR_TAG);
+	uartSendByte(bank);
+	uartSendByte(len);
+	sum = bank + len;
+	mirrorEncode(src, &sum);
+	uartSendByte(sum);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Console command "lcd [ms]". Without argument sends one full frame, with an
+					argument mirrors the changes every ms milliseconds (0 stops).
+-------------------------------------------------------------------------------------------------**/
+void mirrorCommand(char * args)
+{
+	if ( *args )
+	{
+		period = atoi(args);
+		printf_P(PSTR("\nlcd mirror every %u ms"), period);
+	}
+	mirrorFrame();
+}
@@ -0,0 +1,28 @@
+#ifndef MIRROR_H
+#define MIRROR_H
+
+#include <stdint.h>
+
+/* Copy of the LCD on the UART for remote support, decoded by tools/lcdview.
+   One packet per bank, interleaved with the normal text output:
+
+		MIRROR_SYNC MIRROR_TAG bank length payload checksum
+
+   bank		bits 0..2 bank number, MIRROR_LAST set on the last bank of a frame
+   payload	the 84 bytes of the bank, run length encoded:
+				0x00..0x7F	n + 1 literal bytes follow
+				0x80..0xFF	the next byte repeated (n & 0x7F) + 2 times
+   checksum	8-bit sum of bank, length and payload */
+
+#define MIRROR_SYNC			0xFF
+#define MIRROR_TAG			'L'
+#define MIRROR_LAST			0x80
+
+// Largest packet: header, 84 literals in one run plus the control byte, checksum
+#define MIRROR_PACKET_MAX	(4 + 85 + 1)
+
+void mirrorFrame(void);
+void mirrorService(void);
+void mirrorCommand(char * args);
+
+#endif
@@ -0,0 +1,95 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Versioned EEPROM records. A record is stored as
+				[ data (size bytes) ][ version ][ CRC16 low ][ CRC16 high ]
+			where the CRC covers the data and the version byte. A record written by another
+			firmware version, never written or partially written is rejected by nvmLoad.
+-------------------------------------------------------------------------------------------------**/
+#include <stdint.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include "nvm.h"
+
+static uint16_t nvmCRC(const uint8_t * data, uint8_t size, uint8_t version)
+{
+	uint16_t crc = 0xffff;
+
+	while ( size-- )
+		crc = _crc16_update(crc, *data++);
+	return _crc16_update(crc, version);
+}
+
+// Same as nvmCRC, over the data in EEPROM
+static uint16_t nvmCRC_E(uint16_t addr, uint8_t size, uint8_t version)
+{
+	uint16_t crc = 0xffff;
+
+	while ( size-- )
+		crc = _crc16_update(crc, eeprom_read_byte((const uint8_t *)addr++));
+	return _crc16_update(crc, version);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Reads a record from EEPROM
+  Arguments		:	addr - EEPROM address (see nvm.h), data - destination, size - in bytes,
+					version - expected record version
+  Return		: 	1 if the record is valid. Otherwise 0 and the contents of data are undefined.
+-------------------------------------------------------------------------------------------------**/
+uint8_t nvmLoad(uint16_t addr, void * data, uint8_t size, uint8_t version)
+{
+	uint16_t crc;
+
+	eeprom_read_block(data, (const void *)addr, size);
+	if ( eeprom_read_byte((const uint8_t *)(addr + size)) != version )
+		return 0;
+	crc = eeprom_read_word((const uint16_t *)(addr + size + 1));
+
+	return crc == nvmCRC(data, size, version);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Writes a record to EEPROM. Only changed bytes are written. Blocks for about 
+					3.4 ms per changed byte.
+-------------------------------------------------------------------------------------------------**/
+void nvmSave(uint16_t addr, const void * data, uint8_t size, uint8_t version)
+{
+	eeprom_update_block(data, (void *)addr, size);
+	eeprom_update_byte((uint8_t *)(addr + size), version);
+	eeprom_update_word((uint16_t *)(addr + size + 1), nvmCRC(data, size, version));
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Checks a record without reading it into RAM
+  Return		: 	1 if the record is valid
+-------------------------------------------------------------------------------------------------**/
+uint8_t nvmValid(uint16_t addr, uint8_t size, uint8_t version)
+{
+	if ( eeprom_read_byte((const uint8_t *)(addr + size)) != version )
+		return 0;
+	return eeprom_read_word((const uint16_t *)(addr + size + 1)) == nvmCRC_E(addr, size, version);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Reads part of a record, no check (see nvmValid)
+-------------------------------------------------------------------------------------------------**/
+void nvmRead(uint16_t addr, uint8_t offset, void * data, uint8_t size)
+{
+	eeprom_read_block(data, (const void *)(addr + offset), size);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Writes part of a record. Call nvmSeal when all parts are written, until
+					then nvmValid rejects the record.
+-------------------------------------------------------------------------------------------------**/
+void nvmWrite(uint16_t addr, uint8_t offset, const void * data, uint8_t size)
+{
+	eeprom_update_block(data, (void *)(addr + offset), size);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Writes the version and CRC of a record written with nvmWrite
+-------------------------------------------------------------------------------------------------**/
+void nvmSeal(uint16_t addr, uint8_t size, uint8_t version)
+{
+	eeprom_update_byte((uint8_t *)(addr + size), version);
+	eeprom_update_word((uint16_t *)(addr + size + 1), nvmCRC_E(addr, size, version));
+}
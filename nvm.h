@@ -0,0 +1,27 @@
+#ifndef NVM_H
+#define NVM_H
+
+#include <stdint.h>
+
+/* EEPROM map. Every record is followed by a version byte and a CRC16, see nvm.c. 
+   Addresses are fixed so that stored data survives firmware updates. */
+#define NVM_MG811_CAL		0x000
+#define NVM_KEYMAP			0x010
+#define NVM_HUMIDITY		0x090
+#define NVM_VENT			0x0a0
+#define NVM_RELAY			0x0b0
+#define NVM_CLOCK			0x0c8
+#define NVM_SCHEDULE		0x0d8
+
+#define NVM_OVERHEAD		3
+
+uint8_t nvmLoad(uint16_t addr, void * data, uint8_t size, uint8_t version);
+void nvmSave(uint16_t addr, const void * data, uint8_t size, uint8_t version);
+
+/* Records too big for a RAM copy are checked, read and written in place */
+uint8_t nvmValid(uint16_t addr, uint8_t size, uint8_t version);
+void nvmRead(uint16_t addr, uint8_t offset, void * data, uint8_t size);
+void nvmWrite(uint16_t addr, uint8_t offset, const void * data, uint8_t size);
+void nvmSeal(uint16_t addr, uint8_t size, uint8_t version);
+
+#endif
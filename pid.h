@@ -0,0 +1,127 @@
+/**------------------------------------------------------------------------------------------------
+  Name		:	pid.h
+  Description :	Integer PI controller and time proportioning output. The state of each instance
+				is a struct owned by the caller. No floats: gains are in 1/2^PID_SHIFT of output
+				per unit of error, the integral keeps the same fractional bits.
+
+				pidStep	- one step of the controller, output clamped to 0..max
+				tpoStep	- one tick of a time proportioning cycle, turns an output into an
+						  on/off relay with a fixed period
+
+				Anti-windup uses both integral clamping (the integral alone never leaves the
+				output range) and conditional integration (no integration while the output is
+				saturated in the direction of the error), so the controller leaves saturation as
+				soon as the error changes sign. Host tools include this header as it is.
+-------------------------------------------------------------------------------------------------**/
+#ifndef PID_H
+#define PID_H
+
+#include <stdint.h>
+
+#define PID_SHIFT	12
+
+typedef struct {
+	int16_t kp;				// output per unit of error, / 2^PID_SHIFT
+	int16_t ki;				// output per unit of error and step, / 2^PID_SHIFT
+	int16_t max;			// output range is 0..max
+	int32_t integral;		// output * 2^PID_SHIFT
+} pid_Type;
+
+typedef struct {
+	uint16_t cycle;			// ticks per cycle
+	uint16_t minPulse;		// shorter on or off times are dropped, ticks
+	uint16_t phase;
+	uint16_t on;			// on time of the current cycle, ticks
+} tpo_Type;
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Initializers. pidPreset sets the integral so that the output starts at out,
+					for a bumpless transfer from manual or forced operation.
+-------------------------------------------------------------------------------------------------**/
+static inline void pidInit(pid_Type * p, int16_t kp, int16_t ki, int16_t max)
+{
+	p->kp = kp;
+	p->ki = ki;
+	p->max = max;
+	p->integral = 0;
+}
+
+static inline void pidPreset(pid_Type * p, int16_t out)
+{
+	p->integral = (int32_t)out << PID_SHIFT;
+}
+
+static inline void tpoInit(tpo_Type * t, uint16_t cycle, uint16_t minPulse)
+{
+	t->cycle = cycle;
+	t->minPulse = minPulse;
+	t->phase = 0;
+	t->on = 0;
+}
+
+// The next tpoStep starts a new cycle with the output it is given
+static inline void tpoRestart(tpo_Type * t)
+{
+	t->phase = 0;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	One controller step
+  Argument(s)	:	error -> setpoint distance, positive to raise the output
+  Return		: 	output, 0..max
+-------------------------------------------------------------------------------------------------**/
+static inline int16_t pidStep(pid_Type * p, int16_t error)
+{
+	int32_t max = (int32_t)p->max << PID_SHIFT;
+	int32_t integral = p->integral + (int32_t)p->ki * error;
+	int32_t out;
+
+	if ( integral < 0 )
+		integral = 0;
+	else if ( integral > max )
+		integral = max;
+
+	out = (int32_t)p->kp * error + integral;
+	if ( out > max )
+	{
+		out = max;
+		if ( error > 0 )
+			integral = p->integral;
+	}
+	else if ( out < 0 )
+	{
+		out = 0;
+		if ( error < 0 )
+			integral = p->integral;
+	}
+	p->integral = integral;
+
+	return out >> PID_SHIFT;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	One tick of the time proportioning output. The on time is taken from out at
+					the start of each cycle and stays fixed until the next one.
+  Argument(s)	:	out -> 0..max, max -> full scale of out
+  Return		: 	relay state for this tick
+-------------------------------------------------------------------------------------------------**/
+static inline uint8_t tpoStep(tpo_Type * t, int16_t out, int16_t max)
+{
+	uint8_t on;
+
+	if ( t->phase == 0 )
+	{
+		t->on = (uint32_t)out * t->cycle / max;
+		if ( t->on < t->minPulse )
+			t->on = 0;
+		else if ( t->cycle - t->on < t->minPulse )
+			t->on = t->cycle;
+	}
+
+	on = t->phase < t->on;
+	if ( ++t->phase >= t->cycle )
+		t->phase = 0;
+	return on;
+}
+
+#endif
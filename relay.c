@@ -0,0 +1,219 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Relay service. Requests only change a table; the outputs change in relayTick(),
+			which first resolves the priorities and the interlocks into a target state, then
+			switches off and only after that switches on, so the two relays of an interlock are
+			never on together: a relay held on by its dwell time keeps its partner off, and a
+			partner only starts one tick after the other one stopped. The counters live in RAM
+			and go to EEPROM every RELAY_FLUSH_S, about 3.4 ms per changed byte, so EEPROM wear
+			is 24 writes a day whatever the switching.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "utils.h"
+#include "timer0.h"
+#include "nvm.h"
+#include "console.h"
+#include "relay.h"
+
+/*** Relays ***/
+static const char relayPump[] PROGMEM = "pump";
+static const char relayVent[] PROGMEM = "vent";
+
+// Keep in the same order as relayId_Type
+static const relayInfo_Type relayInfo[RELAYS] PROGMEM = {
+	/* name		pin */
+	{ relayPump,	6 },		// PORTD.6, water pump
+	{ relayVent,	7 },		// PORTD.7, air vent
+};
+
+// The pump humidifies the air the vent blows out. CO2 goes first: a dry room recovers, stale
+// air harms the crop.
+static const relayInterlock_Type relayInterlocks[] PROGMEM = {
+	{ RELAY_VENT,	RELAY_PUMP },
+};
+
+#define RELAY_INTERLOCKS	(sizeof(relayInterlocks) / sizeof(relayInterlocks[0]))
+
+/*** Source names, for the console ***/
+static const char sourceAuto[] PROGMEM = "auto";
+static const char sourceManual[] PROGMEM = "manual";
+static const char sourceSafety[] PROGMEM = "safety";
+static const char sourceNone[] PROGMEM = "none";
+
+static const char * const sourceNames[RELAY_SOURCES + 1] PROGMEM = {
+	sourceAuto, sourceManual, sourceSafety, sourceNone
+};
+
+static uint8_t requests[RELAYS][RELAY_SOURCES];
+static uint8_t winner[RELAYS];			// source obeyed at the last tick, RELAY_SOURCES if none
+static uint8_t state;					// bit per relay, 1 = on
+static uint32_t lastChange[RELAYS];
+static relayCounters_Type counters;
+static uint16_t flushTime;
+
+static void relayOutput(uint8_t relay, uint8_t on)
+{
+	uint8_t pin = pgm_read_byte(&relayInfo[relay].pin);
+
+	if ( on )
+	{
+		cbi(RELAY_PORT, pin);
+		state |= 1 << relay;
+		counters.operations[relay]++;
+	}
+	else
+	{
+		sbi(RELAY_PORT, pin);
+		state &= ~(1 << relay);
+	}
+	lastChange[relay] = getTicks();
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Switches all relays off, clears the requests and loads the counters
+-------------------------------------------------------------------------------------------------**/
+void relayInit(void)
+{
+	uint8_t i, pin;
+
+	for ( i = 0; i < RELAYS; i++ )
+	{
+		pin = pgm_read_byte(&relayInfo[i].pin);
+		sbi(RELAY_PORT, pin);
+		sbi(RELAY_DDR, pin);
+		// Free to switch at once
+		lastChange[i] = getTicks() - RELAY_DWELL_S * 1000UL;
+		winner[i] = RELAY_SOURCES;
+	}
+	state = 0;
+	memset(requests, RELAY_RELEASE, sizeof(requests));
+
+	if ( !nvmLoad(NVM_RELAY, &counters, sizeof(counters), RELAY_VERSION) )
+		memset(&counters, 0, sizeof(counters));
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Posts the request of a source, applied by the next relayTick()
+  Argument(s)	:	request -> RELAY_ON, RELAY_OFF or RELAY_RELEASE
+-------------------------------------------------------------------------------------------------**/
+void relayRequest(uint8_t relay, uint8_t source, uint8_t request)
+{
+	if ( relay < RELAYS && source < RELAY_SOURCES )
+		requests[relay][source] = request;
+}
+
+uint8_t relayState(uint8_t relay)
+{
+	return (state >> relay) & 1;
+}
+
+void relaySave(void)
+{
+	nvmSave(NVM_RELAY, &counters, sizeof(counters), RELAY_VERSION);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Applies the requests. Call once per second, after the controllers.
+-------------------------------------------------------------------------------------------------**/
+void relayTick(void)
+{
+	relayInterlock_Type lock;
+	uint32_t now = getTicks();
+	uint8_t target = 0, blocked = 0, r, s, loser;
+
+	// Highest priority request of every relay
+	for ( r = 0; r < RELAYS; r++ )
+	{
+		for ( s = RELAY_SOURCES; s-- && requests[r][s] == RELAY_RELEASE; )
+			;
+		winner[r] = ( s < RELAY_SOURCES ) ? s : RELAY_SOURCES;
+		if ( s < RELAY_SOURCES && requests[r][s] == RELAY_ON )
+			target |= 1 << r;
+	}
+
+	// Interlocks: drop the loser from the target, and block every relay whose partner is on
+	for ( r = 0; r < RELAY_INTERLOCKS; r++ )
+	{
+		memcpy_P(&lock, &relayInterlocks[r], sizeof(lock));
+		if ( (target >> lock.first & 1) && (target >> lock.second & 1) )
+		{
+			if ( winner[lock.first] != winner[lock.second] )
+				loser = ( winner[lock.first] > winner[lock.second] ) ? lock.second : lock.first;
+			else
+				loser = ( relayState(lock.second) && !relayState(lock.first) ) ? lock.first : lock.second;
+			target &= ~(1 << loser);
+		}
+		if ( relayState(lock.first) )
+			blocked |= 1 << lock.second;
+		if ( relayState(lock.second) )
+			blocked |= 1 << lock.first;
+	}
+
+	// Off, then on. blocked was taken before, so the partner of a relay switched off now waits
+	// for the next tick, longer than the contacts take to open.
+	for ( r = 0; r < RELAYS; r++ )
+		if ( relayState(r) && !(target >> r & 1) &&
+			( now - lastChange[r] >= RELAY_DWELL_S * 1000UL || winner[r] == RELAY_SAFETY ) )
+			relayOutput(r, 0);
+	for ( r = 0; r < RELAYS; r++ )
+		if ( !relayState(r) && (target >> r & 1) && !(blocked >> r & 1) &&
+			now - lastChange[r] >= RELAY_DWELL_S * 1000UL )
+			relayOutput(r, 1);
+
+	// Counters
+	for ( r = 0; r < RELAYS; r++ )
+		if ( relayState(r) )
+			counters.onTime[r]++;
+	counters.serviceTime++;
+	if ( ++flushTime >= RELAY_FLUSH_S )
+	{
+		flushTime = 0;
+		relaySave();
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Console command
+					relay					- state, counters and wear of every relay
+					relay <name> on|off		- manual override
+					relay <name> auto		- back to the controllers
+					relay save				- write the counters to EEPROM now
+-------------------------------------------------------------------------------------------------**/
+void relayCommand(char * args)
+{
+	char * value = consoleNextArg(args);
+	uint32_t days, rate, ops;
+	uint8_t r;
+
+	if ( !strcmp_P(args, PSTR("save")) )
+		relaySave();
+
+	for ( r = 0; r < RELAYS; r++ )
+		if ( !strcmp_P(args, (const char *)pgm_read_word(&relayInfo[r].name)) )
+		{
+			if ( !strcmp_P(value, PSTR("on")) )
+				relayRequest(r, RELAY_MANUAL, RELAY_ON);
+			else if ( !strcmp_P(value, PSTR("off")) )
+				relayRequest(r, RELAY_MANUAL, RELAY_OFF);
+			else if ( !strcmp_P(value, PSTR("auto")) )
+				relayRequest(r, RELAY_MANUAL, RELAY_RELEASE);
+		}
+
+	days = counters.serviceTime / 86400UL;
+	for ( r = 0; r < RELAYS; r++ )
+	{
+		ops = counters.operations[r];
+		printf_P(PSTR("\nRELAY: %S %u by %S, %lu ops, %lu h on, wear %u %%"),
+			(const char *)pgm_read_word(&relayInfo[r].name), relayState(r),
+			(const char *)pgm_read_word(&sourceNames[winner[r]]),
+			ops, counters.onTime[r] / 3600, (uint16_t)(ops * 100 / RELAY_LIFE));
+		// Remaining life at the average rate so far, after a day of service
+		rate = days ? ops / days : 0;
+		if ( rate && ops < RELAY_LIFE )
+			printf_P(PSTR(", %lu days left"), (RELAY_LIFE - ops) / rate);
+	}
+	printf_P(PSTR("\nRELAY: %lu days of service"), days);
+}
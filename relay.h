@@ -0,0 +1,69 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <stdint.h>
+
+/* Relay service. Controllers and the user do not switch the outputs, they post requests with
+   relayRequest(): every relay keeps one request per source and obeys the one of the highest
+   priority, off if there is none. relayTick(), once a second after the controllers, applies
+   the result with a minimum dwell between changes and the interlocks of relayInterlocks[]
+   (relay.c), and counts operations and on time for the wear estimate. */
+
+// All relays are on this port, active low
+#define RELAY_PORT			PORTD
+#define RELAY_DDR			DDRD
+
+// Time a relay keeps its state after a change. Safety requests to switch off are immediate.
+#define RELAY_DWELL_S		5
+// Counters are written to EEPROM this often (and by "relay save"), a reset loses at most that
+#define RELAY_FLUSH_S		3600
+// Rated electrical life, operations
+#define RELAY_LIFE			100000UL
+
+// Increment when the layout of relayCounters_Type changes
+#define RELAY_VERSION		1
+
+typedef enum {
+	RELAY_PUMP,
+	RELAY_VENT,
+	RELAYS
+} relayId_Type;
+
+/* Sources, in order of priority */
+typedef enum {
+	RELAY_AUTO,						// controllers
+	RELAY_MANUAL,					// user override
+	RELAY_SAFETY,					// limits that must win over the user
+	RELAY_SOURCES
+} relaySource_Type;
+
+/* Requests */
+#define RELAY_RELEASE		0xff	// no request from this source
+#define RELAY_OFF			0
+#define RELAY_ON			1
+
+typedef struct {
+	const char * name;				// in .progmem
+	uint8_t pin;					// bit of RELAY_PORT
+} relayInfo_Type;
+
+/* Relays that must not be on together. When both are requested the one with the higher
+   priority request wins, on a tie the one already on, else the first of the pair. */
+typedef struct {
+	uint8_t first, second;			// relayId_Type
+} relayInterlock_Type;
+
+typedef struct {
+	uint32_t operations[RELAYS];	// off to on changes
+	uint32_t onTime[RELAYS];		// s
+	uint32_t serviceTime;			// s counted by relayTick
+} relayCounters_Type;
+
+void relayInit(void);
+void relayRequest(uint8_t relay, uint8_t source, uint8_t request);
+void relayTick(void);
+uint8_t relayState(uint8_t relay);
+void relaySave(void);
+void relayCommand(char * args);
+
+#endif
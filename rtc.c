@@ -0,0 +1,201 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Software clock. rtcService() takes the milliseconds elapsed since its last call
+			from getTicks(), so a busy main loop delays the clock but never loses time, and
+			adds the trim once per second: a microsecond accumulator gains or drops a whole
+			millisecond when it passes 1000 us. Setting the time again after RTC_SYNC_MIN_S 
+			computes the trim from the difference, so the clock is trimmed without measuring
+			the crystal.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "timer0.h"
+#include "nvm.h"
+#include "console.h"
+#include "rtc.h"
+
+#define RTC_DAY_S		86400UL
+
+static rtcRecord_Type rtc;
+static uint8_t state;
+static uint32_t second;				// of the day
+static int32_t msec;				// not yet counted, may go below 0 with a negative trim
+static int16_t trimAcc;				// us
+static uint32_t lastTicks;
+static uint32_t sinceSet;			// s counted since the clock was set
+
+static void rtcSave(void)
+{
+	rtc.minute = second / 60;
+	nvmSave(NVM_CLOCK, &rtc, sizeof(rtc), RTC_VERSION);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Restores the trim, and the last saved day and time if the clock was set
+-------------------------------------------------------------------------------------------------**/
+void rtcInit(void)
+{
+	if ( !nvmLoad(NVM_CLOCK, &rtc, sizeof(rtc), RTC_VERSION) )
+		memset(&rtc, 0, sizeof(rtc));
+
+	if ( rtc.set && rtc.minute < 1440 )
+		state = RTC_RESTORED;
+	else
+	{
+		rtc.day = 0;
+		rtc.minute = 0;
+		rtc.set = 0;
+		state = RTC_UNSET;
+	}
+	second = rtc.minute * 60UL;
+	lastTicks = getTicks();
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Advances the clock, call from the main loop
+  Return		: 	1 when a new minute started since the last call
+-------------------------------------------------------------------------------------------------**/
+uint8_t rtcService(void)
+{
+	uint32_t now = getTicks();
+	uint8_t minute = 0;
+
+	msec += now - lastTicks;
+	lastTicks = now;
+
+	while ( msec >= 1000 )
+	{
+		msec -= 1000;
+		trimAcc += rtc.trim;
+		while ( trimAcc >= 1000 )
+		{
+			trimAcc -= 1000;
+			msec++;
+		}
+		while ( trimAcc <= -1000 )
+		{
+			trimAcc += 1000;
+			msec--;
+		}
+
+		sinceSet++;
+		if ( ++second == RTC_DAY_S )
+		{
+			second = 0;
+			rtc.day++;
+		}
+		if ( second % 60 == 0 )
+		{
+			minute = 1;
+			// An unset clock would be restored at reset as if it had been set
+			if ( second % 3600 == 0 && state != RTC_UNSET )
+				rtcSave();
+		}
+	}
+	return minute;
+}
+
+uint8_t rtcState(void)
+{
+	return state;
+}
+
+uint16_t rtcDay(void)
+{
+	return rtc.day;
+}
+
+uint16_t rtcMinute(void)
+{
+	return second / 60;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Sets the time of day. Once the clock ran RTC_SYNC_MIN_S since it was set, the
+					difference corrects the trim: error / elapsed time, in ppm.
+-------------------------------------------------------------------------------------------------**/
+static void rtcSetTime(uint32_t time)
+{
+	int32_t error = time - second;
+
+	// The short way around midnight
+	if ( error > (int32_t)(RTC_DAY_S / 2) )
+		error -= RTC_DAY_S;
+	else if ( error < -(int32_t)(RTC_DAY_S / 2) )
+		error += RTC_DAY_S;
+
+	// Larger differences are a new time, not drift
+	if ( state == RTC_SET && sinceSet >= RTC_SYNC_MIN_S && labs(error) <= RTC_SYNC_MAX_S )
+	{
+		error = rtc.trim + error * 1000000 / (int32_t)sinceSet;
+		if ( error > RTC_TRIM_MAX )
+			error = RTC_TRIM_MAX;
+		else if ( error < -RTC_TRIM_MAX )
+			error = -RTC_TRIM_MAX;
+		rtc.trim = error;
+	}
+
+	second = time;
+	msec = 0;
+	trimAcc = 0;
+	sinceSet = 0;
+	state = RTC_SET;
+	rtc.set = 1;
+	rtcSave();
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Console command
+					clock					- show the day, time, trim and state
+					clock <hh:mm[:ss]>		- set the time, corrects the trim after an hour
+					clock day <n>			- set the day of the growing cycle
+					clock trim <ppm>		- set the trim
+-------------------------------------------------------------------------------------------------**/
+void rtcCommand(char * args)
+{
+	char * value = consoleNextArg(args);
+	char * field = args;
+	uint32_t time = 0;
+	uint16_t v;
+	uint8_t i, bad = 0;
+
+	if ( !strcmp_P(args, PSTR("day")) && *value )
+	{
+		rtc.day = atoi(value);
+		rtcSave();
+	}
+	else if ( !strcmp_P(args, PSTR("trim")) && *value )
+	{
+		rtc.trim = atoi(value);
+		if ( rtc.trim > RTC_TRIM_MAX || rtc.trim < -RTC_TRIM_MAX )
+			rtc.trim = 0;
+		rtcSave();
+	}
+	else if ( *args >= '0' && *args <= '9' )
+	{
+		// hh:mm or hh:mm:ss, each field in range like scheduleTime()
+		for ( i = 0; i < 3 && *field; i++ )
+		{
+			v = atoi(field);
+			if ( v >= ( i ? 60 : 24 ) )
+				bad = 1;
+			time = time * 60 + v;
+			while ( *field && *field != ':' )
+				field++;
+			if ( *field == ':' )
+				field++;
+		}
+		if ( i == 2 )
+			time *= 60;
+		if ( i >= 2 && !bad )
+			rtcSetTime(time);
+		else
+			printf_P(PSTR("\nCLOCK: hh 0..23, mm and ss 0..59"));
+	}
+
+	printf_P(PSTR("\nCLOCK: day %u %02u:%02u:%02u trim %d ppm %S"), rtc.day, 
+		(uint8_t)(second / 3600), (uint8_t)(second / 60 % 60), (uint8_t)(second % 60), rtc.trim,
+		state == RTC_SET ? PSTR("") : state == RTC_RESTORED ? PSTR("(restored)") : PSTR("(not set)"));
+}
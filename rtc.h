@@ -0,0 +1,41 @@
+#ifndef RTC_H
+#define RTC_H
+
+#include <stdint.h>
+
+/* Software clock: time of day and day of the growing cycle, counted from the system tick.
+   The crystal error is corrected by a trim in ppm. There is no battery: once the clock was
+   set, the day and the time are saved every hour and restored at reset (RTC_RESTORED) until
+   the clock is set again. A clock never set is not saved and counts from 00:00 again. */
+
+// Largest accepted trim, ppm
+#define RTC_TRIM_MAX		20000
+// A new time sets the trim from the drift when the clock ran at least RTC_SYNC_MIN_S since it
+// was set and was off by RTC_SYNC_MAX_S at most
+#define RTC_SYNC_MIN_S		3600
+#define RTC_SYNC_MAX_S		600
+
+// Increment when the layout of rtcRecord_Type changes
+#define RTC_VERSION			2
+
+typedef enum {
+	RTC_UNSET,						// counting from day 0 00:00 at reset
+	RTC_RESTORED,					// last saved time, late by the time the power was off
+	RTC_SET
+} rtcState_Type;
+
+typedef struct {
+	int16_t trim;					// ppm, positive when the tick is slow
+	uint16_t day;
+	uint16_t minute;
+	uint8_t set;					// day and minute come from a set clock
+} rtcRecord_Type;
+
+void rtcInit(void);
+uint8_t rtcService(void);
+uint8_t rtcState(void);
+uint16_t rtcDay(void);
+uint16_t rtcMinute(void);
+void rtcCommand(char * args);
+
+#endif
@@ -0,0 +1,223 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Climate schedule. The evaluation cost does not depend on the contents: the phase is
+			the one of SCHED_PHASES start days that is the latest not after today, the slot is
+			minute / SCHED_SLOT_MIN, so a tick reads at most SCHED_PHASES words, one slot byte
+			and one profile from EEPROM, and keeps only the applied profile in RAM. A profile
+			is applied when the slot changes to it, so a setpoint changed by hand holds until
+			the next change of the schedule. An invalid record is formatted by the first edit.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "nvm.h"
+#include "console.h"
+#include "humidity.h"
+#include "vent.h"
+#include "schedule.h"
+
+// Offsets in the record
+#define SCHED_PROFILE(p)	(offsetof(schedule_Type, profiles) + (p) * sizeof(scheduleProfile_Type))
+#define SCHED_PHASE(n)		(offsetof(schedule_Type, phases) + (n) * sizeof(schedulePhase_Type))
+#define SCHED_SLOT(n, s)	(SCHED_PHASE(n) + offsetof(schedulePhase_Type, slots) + (s) / 2)
+
+#define SCHED_REAPPLY		0xff	// applied profile after an edit, differs from any slot
+
+static uint8_t valid;
+static uint8_t applied = SCHED_REAPPLY;
+
+void scheduleInit(void)
+{
+	valid = nvmValid(NVM_SCHEDULE, SCHED_SIZE, SCHED_VERSION);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Phase of a day of the cycle
+  Return		: 	SCHED_PHASES if no phase has started yet
+-------------------------------------------------------------------------------------------------**/
+static uint8_t schedulePhase(uint16_t day)
+{
+	uint16_t start, latest = 0;
+	uint8_t i, phase = SCHED_PHASES;
+
+	for ( i = 0; i < SCHED_PHASES; i++ )
+	{
+		nvmRead(NVM_SCHEDULE, SCHED_PHASE(i), &start, sizeof(start));
+		if ( start != SCHED_UNUSED && start <= day && ( phase == SCHED_PHASES || start >= latest ) )
+		{
+			latest = start;
+			phase = i;
+		}
+	}
+	return phase;
+}
+
+static uint8_t scheduleSlot(uint8_t phase, uint8_t slot)
+{
+	uint8_t b;
+
+	nvmRead(NVM_SCHEDULE, SCHED_SLOT(phase, slot), &b, 1);
+	return ( slot & 1 ) ? b >> 4 : b & 0x0f;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Applies the profile of the current slot if it changed. Call once a minute,
+					only when the clock is set or restored.
+  Argument(s)	:	day -> of the growing cycle, minute -> of the day
+-------------------------------------------------------------------------------------------------**/
+void scheduleTick(uint16_t day, uint16_t minute)
+{
+	scheduleProfile_Type profile;
+	uint8_t phase, p;
+
+	if ( !valid )
+		return;
+
+	phase = schedulePhase(day);
+	p = ( phase < SCHED_PHASES ) ? scheduleSlot(phase, minute / SCHED_SLOT_MIN) : SCHED_NONE;
+	if ( p == applied )
+		return;
+	applied = p;
+	if ( p >= SCHED_PROFILES )
+		return;
+
+	nvmRead(NVM_SCHEDULE, SCHED_PROFILE(p), &profile, sizeof(profile));
+	if ( profile.humidity )
+		humidityTarget(profile.humidity);
+	if ( profile.co2 )
+		ventTarget(profile.co2);
+	printf_P(PSTR("\nSCHED: day %u phase %u profile %u"), day, phase, p);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Makes the record valid before an edit: no profile values, no phase
+-------------------------------------------------------------------------------------------------**/
+static void scheduleFormat(void)
+{
+	scheduleProfile_Type profile = { 0, 0 };
+	uint16_t unused = SCHED_UNUSED;
+	uint8_t empty = (SCHED_NONE << 4) | SCHED_NONE;
+	uint8_t i, s;
+
+	for ( i = 0; i < SCHED_PROFILES; i++ )
+		nvmWrite(NVM_SCHEDULE, SCHED_PROFILE(i), &profile, sizeof(profile));
+	for ( i = 0; i < SCHED_PHASES; i++ )
+	{
+		nvmWrite(NVM_SCHEDULE, SCHED_PHASE(i), &unused, sizeof(unused));
+		for ( s = 0; s < SCHED_SLOTS; s += 2 )
+			nvmWrite(NVM_SCHEDULE, SCHED_SLOT(i, s), &empty, 1);
+	}
+	valid = 1;
+}
+
+// Minutes of "hh:mm", -1 if not a time of day
+static int16_t scheduleTime(const char * s)
+{
+	int16_t h = atoi(s), m;
+
+	while ( *s >= '0' && *s <= '9' )
+		s++;
+	if ( *s++ != ':' || *s < '0' || *s > '9' )
+		return -1;
+	m = atoi(s);
+	return ( h < 24 && m < 60 ) ? h * 60 + m : -1;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Console command
+					sched							- show the profiles and the phases
+					sched profile <p> <rh> <ppm>	- set a profile, 0 leaves a value unchanged
+					sched phase <n> <day>|off		- first day of the cycle of a phase
+					sched <n> <hh:mm> <hh:mm> <p>|-	- profile of phase n from the first time to
+													  the second, across midnight if earlier,
+													  the whole day if equal
+					sched clear						- remove everything
+-------------------------------------------------------------------------------------------------**/
+void scheduleCommand(char * args)
+{
+	scheduleProfile_Type profile;
+	char * arg1 = consoleNextArg(args);
+	char * arg2 = consoleNextArg(arg1);
+	char * arg3 = consoleNextArg(arg2);
+	int16_t from, to, rh, co2;
+	uint16_t start;
+	uint8_t n = atoi(arg1), i, s, b, p;
+
+	if ( *args && ( !valid || !strcmp_P(args, PSTR("clear")) ) )
+		scheduleFormat();
+
+	if ( !strcmp_P(args, PSTR("profile")) && n < SCHED_PROFILES && *arg3 )
+	{
+		rh = atoi(arg2);
+		co2 = atoi(arg3);
+		profile.humidity = rh;
+		profile.co2 = co2;
+		// The ranges of "hum set" and "vent set"
+		if ( rh >= 0 && rh <= 1000 && ( co2 == 0 || co2 >= 400 ) )
+			nvmWrite(NVM_SCHEDULE, SCHED_PROFILE(n), &profile, sizeof(profile));
+		else
+			printf_P(PSTR("\nSCHED: rh 1..1000, co2 400 ppm or more, 0 unchanged"));
+	}
+	else if ( !strcmp_P(args, PSTR("phase")) && n < SCHED_PHASES && *arg2 )
+	{
+		start = strcmp_P(arg2, PSTR("off")) ? (uint16_t)atoi(arg2) : SCHED_UNUSED;
+		nvmWrite(NVM_SCHEDULE, SCHED_PHASE(n), &start, sizeof(start));
+	}
+	else if ( *args >= '0' && *args <= '9' )
+	{
+		n = atoi(args);
+		from = scheduleTime(arg1);
+		to = scheduleTime(arg2);
+		p = ( *arg3 == '-' ) ? SCHED_NONE : atoi(arg3);
+		if ( n < SCHED_PHASES && from >= 0 && to >= 0 && *arg3 && ( p < SCHED_PROFILES || p == SCHED_NONE ) )
+		{
+			if ( from != to && from / SCHED_SLOT_MIN == to / SCHED_SLOT_MIN )
+				printf_P(PSTR("\nSCHED: less than %u minutes"), SCHED_SLOT_MIN);
+			else
+			{
+				// The end is tested after the first slot, so equal times cover the whole day
+				s = from / SCHED_SLOT_MIN;
+				do
+				{
+					nvmRead(NVM_SCHEDULE, SCHED_SLOT(n, s), &b, 1);
+					b = ( s & 1 ) ? ( b & 0x0f ) | ( p << 4 ) : ( b & 0xf0 ) | p;
+					nvmWrite(NVM_SCHEDULE, SCHED_SLOT(n, s), &b, 1);
+					s = ( s + 1 ) % SCHED_SLOTS;
+				}
+				while ( s != to / SCHED_SLOT_MIN );
+			}
+		}
+	}
+
+	if ( *args )
+	{
+		nvmSeal(NVM_SCHEDULE, SCHED_SIZE, SCHED_VERSION);
+		applied = SCHED_REAPPLY;
+	}
+	if ( !valid )
+	{
+		printf_P(PSTR("\nSCHED: empty"));
+		return;
+	}
+
+	for ( i = 0; i < SCHED_PROFILES; i++ )
+	{
+		nvmRead(NVM_SCHEDULE, SCHED_PROFILE(i), &profile, sizeof(profile));
+		if ( profile.humidity || profile.co2 )
+			printf_P(PSTR("\nSCHED: profile %u rh %u co2 %u"), i, profile.humidity, profile.co2);
+	}
+	// One character per slot, '-' for none
+	for ( i = 0; i < SCHED_PHASES; i++ )
+	{
+		nvmRead(NVM_SCHEDULE, SCHED_PHASE(i), &start, sizeof(start));
+		if ( start == SCHED_UNUSED )
+			continue;
+		printf_P(PSTR("\nSCHED: phase %u day %u "), i, start);
+		for ( s = 0; s < SCHED_SLOTS; s++ )
+		{
+			p = scheduleSlot(i, s);
+			putchar( p < SCHED_PROFILES ? '0' + p : '-' );
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Climate profiles by time of day and day of the growing cycle. A profile holds the humidity
+   and CO2 setpoints. The cycle is split into up to SCHED_PHASES phases by their start day,
+   and every phase maps each SCHED_SLOT_MIN minutes of the day to a profile, or to none to
+   keep the current setpoints. The whole table stays in EEPROM (NVM_SCHEDULE); scheduleTick()
+   reads a few bytes of it each minute and applies the profile when it changes. */
+
+#define SCHED_PROFILES		8
+#define SCHED_PHASES		4
+#define SCHED_SLOT_MIN		15
+#define SCHED_SLOTS			(1440 / SCHED_SLOT_MIN)
+
+#define SCHED_NONE			0x0f	// slot without a profile (erased EEPROM)
+#define SCHED_UNUSED		0xffff	// startDay of an unused phase
+
+// Increment when the layout of schedule_Type changes
+#define SCHED_VERSION		1
+
+typedef struct {
+	uint16_t humidity;				// tenths of %RH, 0 = unchanged
+	uint16_t co2;					// ppm, 0 = unchanged
+} scheduleProfile_Type;
+
+typedef struct {
+	uint16_t startDay;				// SCHED_UNUSED if the phase is not used
+	uint8_t slots[SCHED_SLOTS / 2];	// profile of each slot, two per byte, low nibble first
+} schedulePhase_Type;
+
+// Layout of the record, never held in RAM
+typedef struct {
+	scheduleProfile_Type profiles[SCHED_PROFILES];
+	schedulePhase_Type phases[SCHED_PHASES];
+} schedule_Type;
+
+#define SCHED_SIZE			sizeof(schedule_Type)
+
+void scheduleInit(void);
+void scheduleTick(uint16_t day, uint16_t minute);
+void scheduleCommand(char * args);
+
+#endif
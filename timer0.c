@@ -2,31 +2,61 @@
 #include <stdint.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include "config.h"
+
+#define T0_PRESCALER	64
+#define T0_TOP			(F_CPU / T0_PRESCALER / TICK_RATE_HZ - 1)
+
+#if T0_TOP > 255
+	#error Timer0 cannot generate TICK_RATE_HZ with the current prescaler. Increase T0_PRESCALER.
+#endif
 
 uint8_t OneSecondFlag = 0;
+volatile uint32_t Ticks = 0;
 
 /**-------------------------------------------------------------------------------------------------
-  Description : Set-up overflow interrupt on Timer0
+  Description : Set-up Timer0 in fast PWM mode with TOP = OCR0A generating a TICK_RATE_HZ compare
+				interrupt. The period and the compare match are those of CTC mode, and OC0B can
+				output the backlight PWM (see backlight.c).
 -------------------------------------------------------------------------------------------------**/
 void initTimer0()
 {
-	// Normal port operation
-	TCCR0A = 0;
-	// Prescaler 1
-	TCCR0B = (1<<CS00);
-	// Overflow interrupt
-	TIMSK0 = (1<<TOIE0);
+	// Normal port operation, fast PWM mode 7 (TOP = OCR0A)
+	TCCR0A = (1<<WGM01) | (1<<WGM00);
+	OCR0A = T0_TOP;
+	// Prescaler 64
+	TCCR0B = (1<<WGM02) | (1<<CS01) | (1<<CS00);
+	// Compare A interrupt
+	TIMSK0 = (1<<OCIE0A);
+}
+
+/**-------------------------------------------------------------------------------------------------
+  Description : Returns the number of ticks (milliseconds) elapsed since initTimer0
+-------------------------------------------------------------------------------------------------**/
+uint32_t getTicks(void)
+{
+	uint32_t ticks;
+	uint8_t sreg = SREG;
+
+	cli();
+	ticks = Ticks;
+	SREG = sreg;
+
+	return ticks;
 }
 
 /**-------------------------------------------------------------------------------------------------
-  Description : set OneSecondFlag to 1 each second
+  Description : count ticks and set OneSecondFlag to 1 each second. Servicing this interrupt 
+				also clears OCF0A, which re-arms the ADC auto trigger.
 -------------------------------------------------------------------------------------------------**/
-ISR (TIMER0_OVF_vect)
+ISR (TIMER0_COMPA_vect)
 {
-	static uint16_t count = 62500;// - 1s
+	static uint16_t count = TICK_RATE_HZ;// - 1s
+
+	Ticks++;
 	if(!--count)
 	{
 		OneSecondFlag = 1;
-		count = 62500;
+		count = TICK_RATE_HZ;
 	}
 }
@@ -3,8 +3,13 @@
 
 #include <stdint.h>
 
+/* Rate of the system tick. Timer0 compare match A also auto-triggers the ADC (see adc.h). */
+#define TICK_RATE_HZ	1000
+
 void initTimer0(void);
+uint32_t getTicks(void);
 
 extern uint8_t OneSecondFlag;
+extern volatile uint32_t Ticks;
 
 #endif
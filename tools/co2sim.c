@@ -0,0 +1,328 @@
+/**------------------------------------------------------------------------------------------------
+  Name		: 	co2sim.c
+  Description : 	Host simulation of the CO2 vent controller in a grow room, one step per second.
+				vent.c and relay.c are built as they are (tools/host stands in for the AVR
+				headers), so the simulation runs ventTick() and relayTick() of the firmware,
+				with the relay dwell and the vent/pump interlock. The pump is requested by
+				the humidity controller's source for -w % of every 10 minutes. The plant is a
+				single well mixed room:
+					dC/dt = (G * 1e6 - (leak + fan * relay) * (C - outside)) / V
+				with the MG811 modelled as a first order lag followed by the firmware EMA.
+				Half way through the run the CO2 production rises by half (a flush).
+
+				The last hour before the flush and the last hour of the run are checked: the
+				room must settle within -e ppm of the setpoint on average with no more than
+				-r ppm peak to peak (the ripple of the relay cycle), and the swing of the last
+				half hour must not be larger than the one before it. The exit status is 1 if
+				any check fails, so this doubles as a regression test of the defaults.
+
+  Usage		:	co2sim [-p kp] [-i ki] [-c cycle s] [-s setpoint] [-u ceiling] [-v volume m3]
+					   [-f fan m3/h] [-l leak m3/h] [-g CO2 production l/h] [-h hours]
+					   [-w pump %] [-e ppm] [-r ppm] [-t seconds]
+				-t prints the time, room ppm, sensor ppm, duty, vent and pump every that many
+				   seconds
+				co2sim -x [...]		runs a grid of gains around -p and -i
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <avr/io.h>
+#include "filter.h"
+#include "mg811.h"
+#include "mg811cal.h"
+#include "console.h"
+#include "relay.h"
+#include "vent.h"
+
+// Pump demand period, s
+#define PUMP_PERIOD		600
+
+static int kp = VENT_KP, ki = VENT_KI, cycle = VENT_CYCLE;
+static int setpoint = VENT_SETPOINT, ceiling = VENT_CEILING;
+static double volume = 10, fan = 100, leak = 1, production = 20, outside = 420;
+static double sensorLag = 60;			// s, MG811 response
+static double start = 3000;				// ppm in the closed room at power up
+static int hours = 12;
+static int pumpDuty = 10;				// % of PUMP_PERIOD
+static double maxError = 50, maxRipple = 300;
+static int traceEvery;
+
+typedef struct {
+	double mean, min, max;				// room ppm
+	double swing[2];					// peak to peak of the two halves
+} window_Type;
+
+typedef struct {
+	window_Type w[2];					// before the flush, end of the run
+	double duty;						// average relay on time, end of the run
+	long switches;						// relay starts per hour over the run
+	int ceilingSeconds;
+	long pumpDelayed;					// s the pump waited for the vent
+	int pass;
+} result_Type;
+
+/*** What vent.c and relay.c need from the rest of the firmware ***/
+volatile uint8_t PORTD, DDRD;
+static uint32_t ticks;
+static uint16_t reading;				// ppm
+
+uint32_t getTicks(void)
+{
+	return ticks;
+}
+
+uint16_t MG811_ReadPPM(void)
+{
+	return reading;
+}
+
+MG811_CalState_Type MG811_CalState(void)
+{
+	return MG811_IDLE;
+}
+
+uint8_t nvmLoad(uint16_t addr, void * data, uint8_t size, uint8_t version)
+{
+	return 0;
+}
+
+void nvmSave(uint16_t addr, const void * data, uint8_t size, uint8_t version)
+{
+}
+
+char * consoleNextArg(char * args)
+{
+	while ( *args && *args != ' ' )
+		args++;
+	while ( *args == ' ' )
+		*args++ = '\0';
+	return args;
+}
+
+// The console output of the firmware is not shown
+int printf_P(const char * fmt, ...)
+{
+	return 0;
+}
+
+// Settings through the console command, as a user would
+static void ventSet(const char * fmt, ...)
+{
+	char line[CONSOLE_LINE_SIZE];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	ventCommand(line);
+}
+
+static void windowAdd(window_Type * w, double c, int t, int length, double lo[2], double hi[2])
+{
+	int half = t >= length / 2;
+
+	w->mean += c / length;
+	if ( c < w->min ) w->min = c;
+	if ( c > w->max ) w->max = c;
+	if ( c < lo[half] ) lo[half] = c;
+	if ( c > hi[half] ) hi[half] = c;
+}
+
+static int run(int kp, int ki, result_Type * r)
+{
+	filterEMA_Type ema;
+	double room = start, sensor = start;
+	double lo[2][2], hi[2][2];
+	long t, length = hours * 3600L, flush = length / 2, on = 0;
+	uint8_t relay, last = 0, pump;
+	int k, i;
+
+	memset(r, 0, sizeof(*r));
+	for ( k = 0; k < 2; k++ )
+	{
+		r->w[k].min = 1e9;
+		r->w[k].max = 0;
+		for ( i = 0; i < 2; i++ )
+		{
+			lo[k][i] = 1e9;
+			hi[k][i] = 0;
+		}
+	}
+
+	ticks = 0;
+	relayInit();
+	ventInit();
+	ventSet("gain %d %d", kp, ki);
+	ventSet("set %d %d", setpoint, ceiling);
+	ventSet("cycle %d", cycle);
+	filterEMAInit(&ema, MG811_EMA_SHIFT);
+
+	for ( t = 0; t < length; t++ )
+	{
+		ticks += 1000;
+
+		// Sensor and firmware filter
+		sensor += (room - sensor) / sensorLag;
+		reading = filterEMA(&ema, (int16_t)(sensor + 0.5));
+		if ( reading < 400 )
+			reading = 400;
+
+		// Firmware, as the main loop runs it
+		pump = t % PUMP_PERIOD < PUMP_PERIOD * pumpDuty / 100;
+		relayRequest(RELAY_PUMP, RELAY_AUTO, pump ? RELAY_ON : RELAY_OFF);
+		ventTick();
+		relayTick();
+		relay = relayState(RELAY_VENT);
+		if ( pump && !relayState(RELAY_PUMP) )
+			r->pumpDelayed++;
+		if ( ventStatus()->state == VENT_CEILING_FORCED )
+			r->ceilingSeconds++;
+		if ( relay && !last )
+			r->switches++;
+		last = relay;
+
+		// Room
+		room += ((t >= flush ? 1.5 : 1) * production * 1000 / volume
+			- (leak + fan * relay) * (room - outside) / volume) / 3600;
+
+		if ( t >= flush - 3600 && t < flush )
+			windowAdd(&r->w[0], room, t - (flush - 3600), 3600, lo[0], hi[0]);
+		if ( t >= length - 3600 )
+		{
+			windowAdd(&r->w[1], room, t - (length - 3600), 3600, lo[1], hi[1]);
+			on += relay;
+		}
+
+		if ( traceEvery && t % traceEvery == 0 )
+			printf("%6ld %6.0f %5u %4u %u %u\n", t, room, reading, ventStatus()->duty, relay,
+				relayState(RELAY_PUMP));
+	}
+
+	r->duty = on / 3600.0;
+	r->switches = r->switches / hours;
+	r->pass = 1;
+	for ( k = 0; k < 2; k++ )
+	{
+		r->w[k].swing[0] = hi[k][0] - lo[k][0];
+		r->w[k].swing[1] = hi[k][1] - lo[k][1];
+		if ( r->w[k].mean - setpoint > maxError || setpoint - r->w[k].mean > maxError )
+			r->pass = 0;
+		if ( r->w[k].max - r->w[k].min > maxRipple )
+			r->pass = 0;
+		// Growing oscillation, with 5 ppm for the rounding of the relay cycle
+		if ( r->w[k].swing[1] > r->w[k].swing[0] + 5 )
+			r->pass = 0;
+	}
+	return r->pass;
+}
+
+static void report(const result_Type * r)
+{
+	static const char * names[2] = { "before flush", "end of run  " };
+	int k;
+
+	for ( k = 0; k < 2; k++ )
+		printf("%s: mean %.0f ppm, %.0f..%.0f ppm, swing %.0f then %.0f ppm\n", names[k],
+			r->w[k].mean, r->w[k].min, r->w[k].max, r->w[k].swing[0], r->w[k].swing[1]);
+	printf("vent: %.0f %% duty at the end, %ld starts per hour, %d s above the ceiling\n",
+		r->duty * 100, r->switches, r->ceilingSeconds);
+	printf("pump: %ld s held off by the interlock\n", r->pumpDelayed);
+	printf("%s\n", r->pass ? "stable" : "FAILED");
+}
+
+// Gain of the sweep grid, in quarters of the given one
+static int gain(int g, int quarters)
+{
+	long v = (long)g * quarters / 4;
+
+	return v > INT16_MAX ? INT16_MAX : v;
+}
+
+static void sweep(void)
+{
+	static const int scale[] = { 1, 2, 4, 8, 16, 32 };		// quarters
+	result_Type r;
+	int p, i;
+
+	printf("kp \\ ki");
+	for ( i = 0; i < 6; i++ )
+		printf("%9d", gain(ki, scale[i]));
+	printf("\n");
+	for ( p = 0; p < 6; p++ )
+	{
+		printf("%7d", gain(kp, scale[p]));
+		for ( i = 0; i < 6; i++ )
+		{
+			run(gain(kp, scale[p]), gain(ki, scale[i]), &r);
+			printf("  %4.0f %s", r.w[1].max - r.w[1].min, r.pass ? "ok" : "--");
+		}
+		printf("\n");
+	}
+	printf("peak to peak ppm at the end of the run, ok if stable\n");
+}
+
+int main(int argc, char **argv)
+{
+	result_Type r;
+	int i, dosweep = 0;
+
+	for ( i = 1; i < argc; i++ )
+	{
+		if ( !strcmp(argv[i], "-x") )
+			dosweep = 1;
+		else if ( i + 1 >= argc )
+			break;
+		else if ( !strcmp(argv[i], "-p") )
+			kp = atoi(argv[++i]);
+		else if ( !strcmp(argv[i], "-i") )
+			ki = atoi(argv[++i]);
+		else if ( !strcmp(argv[i], "-c") )
+			cycle = atoi(argv[++i]);
+		else if ( !strcmp(argv[i], "-s") )
+			setpoint = atoi(argv[++i]);
+		else if ( !strcmp(argv[i], "-u") )
+			ceiling = atoi(argv[++i]);
+		else if ( !strcmp(argv[i], "-v") )
+			volume = atof(argv[++i]);
+		else if ( !strcmp(argv[i], "-f") )
+			fan = atof(argv[++i]);
+		else if ( !strcmp(argv[i], "-l") )
+			leak = atof(argv[++i]);
+		else if ( !strcmp(argv[i], "-g") )
+			production = atof(argv[++i]);
+		else if ( !strcmp(argv[i], "-h") )
+			hours = atoi(argv[++i]);
+		else if ( !strcmp(argv[i], "-w") )
+			pumpDuty = atoi(argv[++i]);
+		else if ( !strcmp(argv[i], "-e") )
+			maxError = atof(argv[++i]);
+		else if ( !strcmp(argv[i], "-r") )
+			maxRipple = atof(argv[++i]);
+		else if ( !strcmp(argv[i], "-t") )
+			traceEvery = atoi(argv[++i]);
+		else
+			break;
+	}
+	if ( i < argc || hours < 2 || cycle <= 2 * VENT_MIN_PULSE )
+	{
+		fprintf(stderr, "usage: %s [-x] [-p kp] [-i ki] [-c cycle] [-s setpoint] [-u ceiling] "
+			"[-v m3] [-f m3/h] [-l m3/h] [-g l/h] [-h hours] [-w %%] [-e ppm] [-r ppm] [-t s]\n", argv[0]);
+		return 1;
+	}
+
+	if ( dosweep )
+	{
+		sweep();
+		return 0;
+	}
+
+	printf("room %.0f m3, fan %.0f m3/h, leak %.0f m3/h, %.0f l/h CO2 then %.0f l/h\n",
+		volume, fan, leak, production, production * 1.5);
+	printf("setpoint %d ppm, ceiling %d ppm, kp %d ki %d, cycle %d s, pump %d %% of %d s\n",
+		setpoint, ceiling, kp, ki, cycle, pumpDuty, PUMP_PERIOD);
+	run(kp, ki, &r);
+	report(&r);
+	return !r.pass;
+}
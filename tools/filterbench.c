@@ -0,0 +1,146 @@
+/**------------------------------------------------------------------------------------------------
+  Name		: 	filterbench.c
+  Description : 	Host benchmark of the filters of filter.h. Every filter is fed the same noisy
+					stream with spikes, checked against a straightforward reference (sorted window
+					for the medians, plain sum for the boxcar, floating point EMA) and timed. The
+					time is reported in ns and in host cycles per update; the AVR cost is of the
+					same order relative to each other, not in absolute value. The exit status is 1
+					if any filter differs from its reference.
+
+  Usage		:	filterbench [-n updates]
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES()	__rdtsc()
+#else
+#define CYCLES()	0
+#endif
+#include "filter.h"
+
+#define STREAM		4096			// samples, reused for every pass
+
+static int16_t stream[STREAM];
+static long updates = 10000000;
+static volatile int16_t sink;
+
+static int cmp(const void * a, const void * b)
+{
+	return *(const int16_t *)a - *(const int16_t *)b;
+}
+
+// Median of the last n samples up to i, the first sample filling the window
+static int16_t refMedian(int i, int n)
+{
+	int16_t w[7];
+	int k;
+
+	for ( k = 0; k < n; k++ )
+		w[k] = stream[ i - k < 0 ? 0 : i - k ];
+	qsort(w, n, sizeof(w[0]), cmp);
+	return w[n / 2];
+}
+
+static int16_t refBoxcar(int i)
+{
+	int32_t sum = 0;
+	int k;
+
+	for ( k = 0; k < FILTER_BOXCAR_LEN; k++ )
+		sum += stream[ i - k < 0 ? 0 : i - k ];
+	return sum / FILTER_BOXCAR_LEN;
+}
+
+static int check(void)
+{
+	filterEMA_Type ema;
+	filterMedian5_Type m5;
+	filterMedian7_Type m7;
+	filterBoxcar_Type box;
+	double ref = stream[0];
+	int i, bad = 0;
+
+	// The filters only need init, this keeps the compiler from warning about the window
+	memset(&m5, 0, sizeof(m5));
+	memset(&m7, 0, sizeof(m7));
+	memset(&box, 0, sizeof(box));
+	filterEMAInit(&ema, 4);
+	filterMedian5Init(&m5);
+	filterMedian7Init(&m7);
+	filterBoxcarInit(&box);
+	for ( i = 0; i < STREAM; i++ )
+	{
+		int16_t e = filterEMA(&ema, stream[i]);
+
+		ref += (stream[i] - ref) / 16;
+		// The integer EMA truncates, a few codes of lag at most
+		if ( e - ref > 1 || ref - e > 16 )
+			bad |= 1;
+		if ( filterMedian5(&m5, stream[i]) != refMedian(i, 5) )
+			bad |= 2;
+		if ( filterMedian7(&m7, stream[i]) != refMedian(i, 7) )
+			bad |= 4;
+		if ( filterBoxcar(&box, stream[i]) != refBoxcar(i) )
+			bad |= 8;
+	}
+	if ( bad & 1 ) printf("filterEMA differs from the reference\n");
+	if ( bad & 2 ) printf("filterMedian5 differs from the reference\n");
+	if ( bad & 4 ) printf("filterMedian7 differs from the reference\n");
+	if ( bad & 8 ) printf("filterBoxcar differs from the reference\n");
+	return bad;
+}
+
+#define BENCH(name, type, init, update)											\
+	do {																		\
+		type f;																	\
+		clock_t t;																\
+		uint64_t c;																\
+		long n;																	\
+		memset(&f, 0, sizeof(f));												\
+		init(&f);																\
+		t = clock();															\
+		c = CYCLES();															\
+		for ( n = 0; n < updates; n++ )											\
+			sink = update(&f, stream[n & (STREAM - 1)]);						\
+		c = CYCLES() - c;														\
+		t = clock() - t;														\
+		printf("%-14s %6.2f ns %7.1f cycles per update\n", name,				\
+			(double)t / CLOCKS_PER_SEC * 1e9 / updates, (double)c / updates);	\
+	} while (0)
+
+static void emaInit4(filterEMA_Type * f)
+{
+	filterEMAInit(f, 4);
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	if ( argc == 3 && !strcmp(argv[1], "-n") )
+		updates = atol(argv[2]);
+	else if ( argc != 1 )
+	{
+		fprintf(stderr, "usage: %s [-n updates]\n", argv[0]);
+		return 1;
+	}
+
+	// A 12 bit reading with noise and a spike every 97 samples
+	srand(1);
+	for ( i = 0; i < STREAM; i++ )
+		stream[i] = 2000 + rand() % 64 - 32 + ( i % 97 ? 0 : 1500 );
+
+	if ( check() )
+		return 1;
+	printf("all filters match their reference over %d samples\n", STREAM);
+
+	BENCH("filterEMA", filterEMA_Type, emaInit4, filterEMA);
+	BENCH("filterMedian5", filterMedian5_Type, filterMedian5Init, filterMedian5);
+	BENCH("filterMedian7", filterMedian7_Type, filterMedian7Init, filterMedian7);
+	BENCH("filterBoxcar", filterBoxcar_Type, filterBoxcarInit, filterBoxcar);
+	return 0;
+}
@@ -0,0 +1,217 @@
+/**------------------------------------------------------------------------------------------------
+  Name		: 	fontgen.c
+  Description : 	Host tool converting a BDF bitmap font into the packed PROGMEM format of font.h.
+
+				Glyphs are stored as LCD columns (rows bytes each, top bank first, bit 0 = top
+				pixel), so drawing one is a plain column copy. Fixed width fonts need no table
+				besides the bitmap; proportional ones (-p) lose their blank side columns and get
+				a 16-bit column offset per glyph. Only the selected characters are emitted and
+				consecutive codes are grouped into ranges, so subsets (e.g. digits only for a
+				big font) and sparse sets (icons) cost nothing for the gaps.
+
+  Usage		:	fontgen -n name [-c characters] [-p] [-g spacing] font.bdf >> fontdata.h
+				-n	C name of the font_Type object
+				-c	characters to keep, default all of the font
+				-p	proportional, default fixed width (FONTBOUNDINGBOX)
+				-g	blank columns after each glyph, default DWIDTH - BBX width of the first glyph
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAX_WIDTH	48
+#define MAX_HEIGHT	48
+
+typedef struct {
+	int code;
+	int dwidth;
+	int bbw;						// width of the BBX
+	int width;						// columns stored
+	uint8_t col[MAX_WIDTH][MAX_HEIGHT / 8];
+} glyph_Type;
+
+static glyph_Type glyphs[256];
+static int ascent, descent, fbbW, fbbX, rows;
+
+static void fail(const char * msg, const char * arg)
+{
+	fprintf(stderr, "fontgen: %s %s\n", msg, arg ? arg : "");
+	exit(1);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Reads the BDF file into glyphs[], indexed by encoding (0..255 only)
+-------------------------------------------------------------------------------------------------**/
+static void readBDF(const char * path)
+{
+	char line[256];
+	FILE * f = fopen(path, "r");
+	glyph_Type * g = NULL;
+	int code = -1, dwidth = 0, w = 0, h = 0, xo = 0, yo = 0, r = -1, x, y, c, nbits;
+	unsigned long bits;
+	char * end;
+
+	if ( !f )
+		fail("cannot open", path);
+
+	while ( fgets(line, sizeof(line), f) )
+	{
+		if ( sscanf(line, "FONTBOUNDINGBOX %d %*d %d", &fbbW, &fbbX) == 2 ) continue;
+		if ( sscanf(line, "FONT_ASCENT %d", &ascent) == 1 ) continue;
+		if ( sscanf(line, "FONT_DESCENT %d", &descent) == 1 ) continue;
+		if ( sscanf(line, "ENCODING %d", &code) == 1 ) continue;
+		if ( sscanf(line, "DWIDTH %d", &dwidth) == 1 ) continue;
+		if ( sscanf(line, "BBX %d %d %d %d", &w, &h, &xo, &yo) == 4 ) continue;
+		if ( !strncmp(line, "BITMAP", 6) )
+		{
+			if ( ascent + descent > MAX_HEIGHT || xo - fbbX + w > MAX_WIDTH )
+				fail("glyph too big in", path);
+			g = ( code >= 0 && code < 256 ) ? &glyphs[code] : NULL;
+			if ( g )
+			{
+				memset(g, 0, sizeof(*g));
+				g->code = code;
+				g->dwidth = dwidth;
+				g->bbw = w;
+			}
+			r = 0;
+			continue;
+		}
+		if ( !strncmp(line, "ENDCHAR", 7) )
+		{
+			r = -1;
+			code = -1;
+			continue;
+		}
+		if ( r >= 0 && g )
+		{
+			// Row r of the box, leftmost pixel in the MSB of the first hex byte
+			bits = strtoul(line, &end, 16);
+			nbits = (end - line) * 4;
+			y = ascent - (yo + h) + r;
+			for ( x = 0; x < w && x < nbits; x++ )
+			{
+				if ( !( bits >> (nbits - 1 - x) & 1 ) )
+					continue;
+				c = xo - fbbX + x;
+				if ( y >= 0 && y < ascent + descent && c >= 0 )
+				{
+					g->col[c][y / 8] |= 1 << (y % 8);
+					if ( c + 1 > g->width ) g->width = c + 1;
+				}
+			}
+			r++;
+		}
+	}
+	fclose(f);
+
+	if ( ascent + descent <= 0 )
+		fail("no FONT_ASCENT / FONT_DESCENT in", path);
+	rows = (ascent + descent + 7) / 8;
+}
+
+static int blank(const glyph_Type * g, int c)
+{
+	int b;
+
+	for ( b = 0; b < rows; b++ )
+		if ( g->col[c][b] ) return 0;
+	return 1;
+}
+
+int main(int argc, char ** argv)
+{
+	const char * name = NULL, * chars = NULL, * path = NULL;
+	int prop = 0, spacing = -1, i, c, b, n, first, last, start, end, width = 0;
+	int sel[256], nsel = 0, column = 0;
+
+	for ( i = 1; i < argc; i++ )
+	{
+		if ( !strcmp(argv[i], "-n") && i + 1 < argc ) name = argv[++i];
+		else if ( !strcmp(argv[i], "-c") && i + 1 < argc ) chars = argv[++i];
+		else if ( !strcmp(argv[i], "-g") && i + 1 < argc ) spacing = atoi(argv[++i]);
+		else if ( !strcmp(argv[i], "-p") ) prop = 1;
+		else if ( argv[i][0] != '-' && !path ) path = argv[i];
+		else path = NULL, i = argc;
+	}
+	if ( !name || !path )
+	{
+		fprintf(stderr, "usage: fontgen -n name [-c characters] [-p] [-g spacing] font.bdf\n");
+		return 2;
+	}
+
+	for ( c = 0; c < 256; c++ )
+		glyphs[c].code = -1;
+	readBDF(path);
+
+	// Selected glyphs in code order
+	for ( c = 0; c < 256; c++ )
+		if ( glyphs[c].code >= 0 && ( !chars || strchr(chars, c) ) && c )
+			sel[nsel++] = c;
+	if ( !nsel )
+		fail("no glyphs selected from", path);
+
+	if ( spacing < 0 )
+		spacing = glyphs[sel[0]].dwidth - glyphs[sel[0]].bbw > 0 ? glyphs[sel[0]].dwidth - glyphs[sel[0]].bbw : 0;
+
+	printf("/* %s: generated by tools/fontgen from %s, do not edit */\n", name, path);
+	printf("static const uint8_t %s_bitmap[] PROGMEM = {\n", name);
+	for ( i = 0; i < nsel; i++ )
+	{
+		glyph_Type * g = &glyphs[sel[i]];
+
+		start = 0;
+		end = prop ? g->width : fbbW;
+		if ( prop )
+		{
+			while ( start < end && blank(g, start) ) start++;
+			while ( end > start && blank(g, end - 1) ) end--;
+			if ( start == end )		// blank glyph (space): keep its advance
+			{
+				start = 0;
+				end = g->dwidth - spacing > 0 ? g->dwidth - spacing : 1;
+			}
+		}
+		g->width = end - start;
+
+		printf("\t");
+		for ( c = start; c < end; c++ )
+			for ( b = 0; b < rows; b++ )
+				printf("0x%02X,", g->col[c][b]);
+		if ( sel[i] >= 32 && sel[i] < 127 && sel[i] != '\\' )
+			printf("\t// '%c'\n", sel[i]);
+		else
+			printf("\t// %d\n", sel[i]);
+	}
+	printf("};\n");
+
+	if ( prop )
+	{
+		printf("static const uint16_t %s_columns[] PROGMEM = {", name);
+		for ( i = 0; i < nsel; i++ )
+		{
+			printf("%s%d,", i % 16 ? " " : "\n\t", column);
+			column += glyphs[sel[i]].width;
+		}
+		printf("\n\t%d\n};\n", column);
+	}
+	else
+		width = fbbW;
+
+	// Runs of consecutive codes
+	printf("static const fontRange_Type %s_ranges[] PROGMEM = {\n", name);
+	for ( i = 0, n = 0; i < nsel; n++ )
+	{
+		first = sel[i];
+		last = i;
+		while ( last + 1 < nsel && sel[last + 1] == sel[last] + 1 ) last++;
+		printf("\t{ %d, %d, %d },\n", first, last - i + 1, i);
+		i = last + 1;
+	}
+	printf("};\n");
+
+	printf("const font_Type %s PROGMEM = { %s_bitmap, %s%s, %s_ranges, %d, %d, %d, %d };\n\n",
+		name, name, prop ? name : "NULL", prop ? "_columns" : "", name, n, rows, width, spacing);
+	return 0;
+}
@@ -0,0 +1,13 @@
+/**------------------------------------------------------------------------------------------------
+  Name		:	avr/io.h
+  Description :	Host stand-in for the firmware modules that tools build as they are (see co2sim).
+				Only the registers those modules touch, defined by the tool.
+-------------------------------------------------------------------------------------------------**/
+#ifndef HOST_IO_H
+#define HOST_IO_H
+
+#include <stdint.h>
+
+extern volatile uint8_t PORTD, DDRD;
+
+#endif
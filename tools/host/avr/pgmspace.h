@@ -0,0 +1,20 @@
+/**------------------------------------------------------------------------------------------------
+  Name		:	avr/pgmspace.h
+  Description :	Host stand-in for the firmware modules that tools build as they are (see co2sim).
+				Flash is plain memory on the host. printf_P is provided by the tool.
+-------------------------------------------------------------------------------------------------**/
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)				(s)
+#define pgm_read_byte(p)	(*(const uint8_t *)(p))
+#define pgm_read_word(p)	(*(p))
+#define memcpy_P			memcpy
+#define strcmp_P			strcmp
+
+int printf_P(const char * fmt, ...);
+
+#endif
@@ -0,0 +1,300 @@
+/**------------------------------------------------------------------------------------------------
+  Name		: 	lcdemu.c
+  Description : 	Host build of the LCD driver. lph7366.c is compiled with LCD_HOST, which sends
+				every byte to lcdHostSend() below instead of the SPI port. There a PCD8544 model
+				keeps the controller state (instruction set, addressing mode, X/Y address,
+				display mode) and the 84x48 display RAM.
+
+				The scenes of scenes[] are drawn in turn with the driver, each on top of the
+				previous one, one primitive at a time. After each refresh the tool prints the
+				command and data bytes it took and checks that
+					- the panel matches the golden image of the scene (a hash of its pixels),
+					  which catches a drawing bug that the cache and the panel share
+					- the traffic stays within the command and data budgets of the scene,
+					  which catches a refresh sending more than it used to
+					- the emulated display RAM matches LCD.Cache and no command was invalid
+
+  Usage		:	lcdemu [-o directory]	writes directory/<scene>.pbm for every scene
+				lcdemu -g				prints the scenes[] hashes and budgets of the current
+										driver, to paste after an intended change (check
+										the images first)
+				Exit status is 1 if any check fails.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include "lph7366.h"
+
+/*** PCD8544 model ***/
+static struct {
+	uint8_t ram[LCD_LINES][X_RES];
+	uint8_t x, y;
+	uint8_t extended;		// H bit of function set
+	uint8_t vertical;		// V bit of function set
+	uint8_t powerdown;		// PD bit of function set
+	uint8_t mode;			// D and E bits: 0 blank, 1 all on, 2 normal, 3 inverse
+	uint8_t vop, bias, tc;
+} pcd;
+
+/*** Counters since the last call to emuCount ***/
+static unsigned long cmdBytes, dataBytes, badCmds;
+
+// The driver in LCD_with_ASYNC mode is not built on the host, dService only needs a clock
+uint32_t getTicks(void)
+{
+	static uint32_t ticks;
+	return ticks += 1000;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	One byte on the SPI bus with the level of the DC pin
+-------------------------------------------------------------------------------------------------**/
+void lcdHostSend(uint8_t data, uint8_t cd)
+{
+	if ( cd == LCD_DATA )
+	{
+		dataBytes++;
+		pcd.ram[pcd.y][pcd.x] = data;
+		if ( pcd.vertical )
+		{
+			if ( ++pcd.y >= LCD_LINES ) { pcd.y = 0; if ( ++pcd.x >= X_RES ) pcd.x = 0; }
+		}
+		else
+		{
+			if ( ++pcd.x >= X_RES ) { pcd.x = 0; if ( ++pcd.y >= LCD_LINES ) pcd.y = 0; }
+		}
+		return;
+	}
+
+	cmdBytes++;
+	if ( data == 0x00 )										// NOP
+		return;
+	if ( (data & 0xF8) == 0x20 )							// function set, both instruction sets
+	{
+		pcd.powerdown = (data >> 2) & 1;
+		pcd.vertical = (data >> 1) & 1;
+		pcd.extended = data & 1;
+		return;
+	}
+	if ( !pcd.extended )
+	{
+		if ( (data & 0xFA) == 0x08 )						// display control
+			pcd.mode = ((data >> 1) & 2) | (data & 1);
+		else if ( (data & 0xF8) == 0x40 && (data & 7) < LCD_LINES )
+			pcd.y = data & 7;
+		else if ( (data & 0x80) && (data & 0x7F) < X_RES )
+			pcd.x = data & 0x7F;
+		else
+			badCmds++;
+	}
+	else
+	{
+		if ( (data & 0xFC) == 0x04 )						// temperature coefficient
+			pcd.tc = data & 3;
+		else if ( (data & 0xF8) == 0x10 )					// bias system
+			pcd.bias = data & 7;
+		else if ( data & 0x80 )								// Vop
+			pcd.vop = data & 0x7F;
+		else
+			badCmds++;
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Pixel as the panel shows it, display mode included
+-------------------------------------------------------------------------------------------------**/
+static int emuPixel(int x, int y)
+{
+	int bit = (pcd.ram[y / 8][x] >> (y % 8)) & 1;
+
+	switch ( pcd.mode ) {
+		case 0: return 0;
+		case 1: return 1;
+		case 3: return !bit;
+		default: return bit;
+	}
+}
+
+static int emuWritePBM(const char * path)
+{
+	FILE * f = fopen(path, "wb");
+	int x, y, byte;
+
+	if ( !f )
+	{
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "P4\n%d %d\n", X_RES, Y_RES);
+	for ( y = 0; y < Y_RES; y++ )
+	{
+		byte = 0;
+		for ( x = 0; x < X_RES; x++ )
+		{
+			byte = (byte << 1) | emuPixel(x, y);
+			if ( (x & 7) == 7 ) { fputc(byte, f); byte = 0; }
+		}
+		if ( X_RES & 7 )
+			fputc(byte << (8 - (X_RES & 7)), f);
+	}
+	fclose(f);
+	return 0;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	FNV-1a hash of the pixels the panel shows, row by row
+-------------------------------------------------------------------------------------------------**/
+static uint32_t emuHash(void)
+{
+	uint32_t h = 2166136261UL;
+	int x, y;
+
+	for ( y = 0; y < Y_RES; y++ )
+		for ( x = 0; x < X_RES; x++ )
+			h = (h ^ emuPixel(x, y)) * 16777619UL;
+	return h;
+}
+
+/*** Scenes ***/
+static void sceneClear(void)
+{
+	initLCD();
+	dClear();
+}
+
+static void sceneIdle(void)
+{
+}
+
+static void sceneChar(void)
+{
+	dCursor(0, 0);
+	dChar('A');
+	dChar('7');
+	dCharAt(40, 3, 'x', 1);
+}
+
+static void sceneText(void)
+{
+	dCursor(1, 0);
+	dText((uint8_t *)"Hello");
+	dTextAt(0, 16, "12.5", 2);
+	dTextAt(48, 16, "-7", 3);
+}
+
+static void scenePixel(void)
+{
+	dPixel(80, 44, PIXEL_ON);
+	dPixel(0, 47, PIXEL_ON);
+}
+
+static void sceneLine(void)
+{
+	dLine(0, 47, 83, 36, PIXEL_ON, 1);
+	dLine(75, 0, 83, 40, PIXEL_XOR, 2);
+}
+
+static void sceneRectangle(void)
+{
+	dRectangle(2, 38, 30, 46, PIXEL_ON, 1);
+	dFillRect(60, 38, 70, 45, PIXEL_XOR);
+}
+
+static void sceneInvert(void)
+{
+	dInvert(0, 0, X_RES - 1, 7);
+}
+
+typedef struct {
+	const char * name;
+	void (*draw)(void);
+	uint32_t hash;					// golden image, see emuHash
+	unsigned long maxCmd;			// budgets of the refresh, bytes
+	unsigned long maxData;
+} scene_Type;
+
+static const scene_Type scenes[] = {
+	/* name			draw			hash			cmd		data */
+	{ "clear",		sceneClear,		0x7f0310c5UL,	12,		504 },
+	{ "idle",		sceneIdle,		0x7f0310c5UL,	0,		0 },
+	{ "char",		sceneChar,		0x3e3589f9UL,	4,		52 },
+	{ "text",		sceneText,		0xd999f0ecUL,	8,		234 },
+	{ "pixel",		scenePixel,		0x9bf9b69cUL,	2,		81 },
+	{ "line",		sceneLine,		0x170e0f7eUL,	12,		120 },
+	{ "rectangle",	sceneRectangle,	0x13a54557UL,	4,		138 },
+	{ "invert",		sceneInvert,	0x44e14ca3UL,	2,		84 },
+};
+
+#define SCENES	(sizeof(scenes) / sizeof(scenes[0]))
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Draws and refreshes a scene, prints the traffic and runs the checks
+  Return		: 	1 if a check failed
+-------------------------------------------------------------------------------------------------**/
+static int scene(const scene_Type * s, const char * dir, int generate)
+{
+	char path[256];
+	uint32_t hash;
+	int bank, x, diff = 0, fail;
+
+	s->draw();
+	cmdBytes = dataBytes = badCmds = 0;
+	dRefresh();
+
+	for ( bank = 0; bank < LCD_LINES; bank++ )
+		for ( x = 0; x < X_RES; x++ )
+			if ( pcd.ram[bank][x] != LCD.Cache[bank * X_RES + x] )
+				diff++;
+	hash = emuHash();
+
+	if ( dir )
+	{
+		snprintf(path, sizeof(path), "%s/%s.pbm", dir, s->name);
+		emuWritePBM(path);
+	}
+	if ( generate )
+	{
+		// The draw function of a scene is named after it
+		printf("\t{ \"%s\",\tscene%c%s,\t0x%08lxUL,\t%lu,\t\t%lu },\n", s->name,
+			toupper(s->name[0]), s->name + 1, (unsigned long)hash, cmdBytes, dataBytes);
+		return diff || badCmds;
+	}
+
+	fail = diff || badCmds || hash != s->hash || cmdBytes > s->maxCmd || dataBytes > s->maxData;
+	printf("%-10s %6lu %6lu %6lu %6d   %08lx %s\n", s->name, cmdBytes, dataBytes, badCmds, diff,
+		(unsigned long)hash, hash != s->hash ? "IMAGE" : 
+		( cmdBytes > s->maxCmd || dataBytes > s->maxData ) ? "BUDGET" : fail ? "FAIL" : "ok");
+	return fail;
+}
+
+int main(int argc, char ** argv)
+{
+	const char * dir = NULL;
+	int opt, generate = 0, fail = 0;
+	unsigned i;
+
+	for ( opt = 1; opt < argc; opt++ )
+	{
+		if ( !strcmp(argv[opt], "-o") && opt + 1 < argc )
+			dir = argv[++opt];
+		else if ( !strcmp(argv[opt], "-g") )
+			generate = 1;
+		else
+		{
+			fprintf(stderr, "usage: %s [-g] [-o directory]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	// Power-on RAM content is undefined
+	memset(pcd.ram, 0x5A, sizeof(pcd.ram));
+
+	if ( !generate )
+		printf("%-10s %6s %6s %6s %6s   %-8s\n", "scene", "cmd", "data", "badcmd", "diff", "image");
+	for ( i = 0; i < SCENES; i++ )
+		fail |= scene(&scenes[i], dir, generate);
+
+	return fail ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+/**------------------------------------------------------------------------------------------------
+  Name		: 	lcdview.c
+  Description : 	Viewer for the LCD mirror packets sent by mirror.c (format in mirror.h). Reads
+				the UART stream, prints the normal text output on stderr, rebuilds the 84x48
+				frame and shows it in the terminal with half block characters at the end of
+				every frame, or writes it as PBM images.
+
+  Usage		:	lcdview [-c command] [-o prefix] [device or file]
+				-c	sends command and a CR first, e.g. -c "lcd 500" to start mirroring
+				-o	writes prefix0000.pbm, prefix0001.pbm, ... instead of drawing
+				Without a file stdin is read. Set the port up first, for example
+				stty -F /dev/ttyUSB0 38400 raw -echo
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define X_RES			84
+#define LCD_LINES		6
+
+/* Keep in sync with mirror.h */
+#define MIRROR_SYNC		0xFF
+#define MIRROR_TAG		'L'
+#define MIRROR_LAST		0x80
+
+static uint8_t frame[LCD_LINES][X_RES];
+static unsigned long frames, wire;
+
+static int pixel(int x, int y)
+{
+	return (frame[y / 8][x] >> (y % 8)) & 1;
+}
+
+static void draw(void)
+{
+	static const char * blocks[4] = { " ", "\xe2\x96\x80", "\xe2\x96\x84", "\xe2\x96\x88" };
+	int x, y;
+
+	printf("\x1b[H\x1b[2J+");
+	for ( x = 0; x < X_RES; x++ ) putchar('-');
+	printf("+\n");
+	for ( y = 0; y < LCD_LINES * 8; y += 2 )
+	{
+		putchar('|');
+		for ( x = 0; x < X_RES; x++ )
+			fputs(blocks[pixel(x, y) | pixel(x, y + 1) << 1], stdout);
+		printf("|\n");
+	}
+	putchar('+');
+	for ( x = 0; x < X_RES; x++ ) putchar('-');
+	printf("+\nframe %lu, %lu bytes\n", frames, wire);
+	fflush(stdout);
+}
+
+static void writePBM(const char * prefix)
+{
+	char path[256];
+	FILE * f;
+	int x, y, byte;
+
+	snprintf(path, sizeof(path), "%s%04lu.pbm", prefix, frames);
+	if ( !(f = fopen(path, "wb")) )
+	{
+		perror(path);
+		return;
+	}
+	fprintf(f, "P4\n%d %d\n", X_RES, LCD_LINES * 8);
+	for ( y = 0; y < LCD_LINES * 8; y++ )
+	{
+		byte = 0;
+		for ( x = 0; x < X_RES; x++ )
+		{
+			byte = (byte << 1) | pixel(x, y);
+			if ( (x & 7) == 7 ) { fputc(byte, f); byte = 0; }
+		}
+		fputc(byte << (8 - (X_RES & 7)), f);
+	}
+	fclose(f);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Decodes the run length encoded payload into one bank
+  Return		: 	0 if it filled the bank exactly
+-------------------------------------------------------------------------------------------------**/
+static int decode(uint8_t * bank, const uint8_t * p, int len)
+{
+	uint8_t out[X_RES];
+	int i = 0, n, pos = 0;
+
+	while ( i < len )
+	{
+		if ( p[i] & 0x80 )
+		{
+			n = (p[i] & 0x7F) + 2;
+			if ( i + 1 >= len || pos + n > X_RES ) return -1;
+			memset(out + pos, p[i + 1], n);
+			i += 2;
+		}
+		else
+		{
+			n = p[i] + 1;
+			if ( i + 1 + n > len || pos + n > X_RES ) return -1;
+			memcpy(out + pos, p + i + 1, n);
+			i += n + 1;
+		}
+		pos += n;
+	}
+	if ( pos != X_RES ) return -1;
+	memcpy(bank, out, X_RES);
+	return 0;
+}
+
+int main(int argc, char ** argv)
+{
+	const char * command = NULL, * prefix = NULL, * path = NULL;
+	uint8_t packet[260];
+	int c, i, state = 0, len = 0, got = 0;
+	uint8_t sum;
+	FILE * in = stdin;
+
+	for ( i = 1; i < argc; i++ )
+	{
+		if ( !strcmp(argv[i], "-c") && i + 1 < argc )
+			command = argv[++i];
+		else if ( !strcmp(argv[i], "-o") && i + 1 < argc )
+			prefix = argv[++i];
+		else if ( argv[i][0] != '-' && !path )
+			path = argv[i];
+		else
+		{
+			fprintf(stderr, "usage: %s [-c command] [-o prefix] [device or file]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if ( path && !(in = fopen(path, command ? "r+b" : "rb")) )
+	{
+		perror(path);
+		return 1;
+	}
+	if ( command )
+	{
+		fprintf(in, "%s\r", command);
+		fflush(in);
+	}
+
+	/* state: 0 text, 1 got sync, 2 bank, 3 length, 4 payload, 5 checksum */
+	while ( (c = fgetc(in)) != EOF )
+	{
+		switch ( state ) {
+			case 0:
+				if ( c == MIRROR_SYNC ) state = 1;
+				else fputc(c, stderr);
+				break;
+			case 1:
+				if ( c == MIRROR_TAG ) state = 2;
+				else { fputc(MIRROR_SYNC, stderr); fputc(c, stderr); state = 0; }
+				break;
+			case 2:
+				packet[0] = c;
+				state = 3;
+				break;
+			case 3:
+				packet[1] = len = c;
+				got = 0;
+				state = len ? 4 : 5;
+				break;
+			case 4:
+				packet[2 + got++] = c;
+				if ( got == len ) state = 5;
+				break;
+			case 5:
+				state = 0;
+				for ( sum = 0, i = 0; i < len + 2; i++ )
+					sum += packet[i];
+				if ( sum != c || (packet[0] & 0x7F) >= LCD_LINES ||
+					 decode(frame[packet[0] & 0x7F], packet + 2, len) )
+				{
+					fprintf(stderr, "\n[lcdview: bad packet]\n");
+					break;
+				}
+				wire += len + 5;
+				if ( packet[0] & MIRROR_LAST )
+				{
+					if ( prefix ) writePBM(prefix);
+					else draw();
+					frames++;
+					wire = 0;
+				}
+				break;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,182 @@
+/**------------------------------------------------------------------------------------------------
+  Name		: 	mg811lut.c
+  Description : 	Host tool generating mg811lut.h, the PROGMEM table used by MG811_CodeToPPM.
+  
+				The MG811 output is linear in log10(ppm), so the table only holds the 
+				concentration at fixed fractions of a decade above the 400 ppm anchor point:
+					Lut[i] = 10 ^ (ppm0 + i / steps)
+				The sensor specific part (ADC code at 400 ppm and codes per decade) stays in
+				RAM, so a recalibration never needs a new table.
+
+  Usage		:	mg811lut [-p log10(ppm0)] [-s steps per decade] [-d decades] > mg811lut.h
+				mg811lut -c [...]	compares the table against the original pow() formula
+								for every ADC code and prints the error and timing.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/* Defaults, keep in sync with mg811.h / adc.h */
+#define DC_GAIN					(8.5)
+#define MG811_VREF				(3.3)
+#define ZERO_POINT_VOLTAGE		(0.220)
+#define REACTION_VOLTGAE		(0.020)
+#define ADC_RESOLUTION			12
+#define MG811_ZERO_MARGIN		8
+
+static double ppm0 = 2.602;
+static int steps = 32;
+static int decades = 2;
+
+static uint16_t *lut;
+static int lutsize;
+
+static void build(void)
+{
+	int i;
+
+	lutsize = steps * decades + 1;
+	lut = malloc(lutsize * sizeof(*lut));
+	for ( i = 0; i < lutsize; i++ )
+	{
+		double ppm = pow(10, ppm0 + (double)i / steps);
+		lut[i] = ppm > 65534 ? 65534 : (uint16_t)(ppm + 0.5);
+	}
+}
+
+static void emit(void)
+{
+	int i;
+
+	printf("/* Generated by tools/mg811lut.c - do not edit. */\n");
+	printf("#ifndef MG811LUT_H\n#define MG811LUT_H\n\n");
+	printf("#define MG811_LUT_STEPS\t%d\t// table entries per decade\n", steps);
+	printf("#define MG811_LUT_SIZE\t%d\n\n", lutsize);
+	printf("// ppm at 10^(%.3f + i/%d)\n", ppm0, steps);
+	printf("static const uint16_t MG811_Lut[MG811_LUT_SIZE] PROGMEM = {");
+	for ( i = 0; i < lutsize; i++ )
+		printf("%s%5u,", i % 8 ? " " : "\n\t", lut[i]);
+	printf("\n};\n\n#endif\n");
+}
+
+/* Mirrors MG811_SetCurve / MG811_CodeToPPM from mg811.c */
+static uint16_t zero, scale;
+
+static void setcurve(uint16_t z, uint16_t slope)
+{
+	zero = z;
+	scale = ((uint32_t)steps << 16) / slope;
+}
+
+static uint16_t codetoppm(uint16_t code)
+{
+	uint32_t pos;
+	uint16_t idx, lo, hi;
+
+	if ( code >= zero )
+		return ( code - zero <= MG811_ZERO_MARGIN ) ? lut[0] : 0xffff;
+
+	pos = ((uint32_t)(zero - code) * scale) >> 8;
+	idx = pos >> 8;
+	if ( idx >= lutsize - 1 )
+		return lut[lutsize - 1];
+
+	lo = lut[idx];
+	hi = lut[idx + 1];
+	return lo + (((uint32_t)(hi - lo) * (uint8_t)pos) >> 8);
+}
+
+/* The original floating point implementation */
+static float readppm(float volts, float *pcurve)
+{
+	if ( ( volts / DC_GAIN ) >= ZERO_POINT_VOLTAGE )
+		return -1;
+	return powf( 10, ( ( volts / DC_GAIN ) - pcurve[1] ) / pcurve[2] + pcurve[0] );
+}
+
+static void check(void)
+{
+	const uint32_t fullscale = 1UL << ADC_RESOLUTION;
+	float curve[3] = { ppm0, ZERO_POINT_VOLTAGE, REACTION_VOLTGAE / ( ppm0 - 3 ) };
+	double maxerr = 0, ppmatmax = 0;
+	volatile float fsink = 0;
+	volatile uint16_t isink = 0;
+	clock_t t;
+	double tfloat, tlut;
+	uint32_t code;
+	int rep, n = 0;
+
+	setcurve( ZERO_POINT_VOLTAGE * DC_GAIN * fullscale / MG811_VREF + 0.5,
+			  REACTION_VOLTGAE / ( 3 - ppm0 ) * DC_GAIN * fullscale / MG811_VREF + 0.5 );
+
+	for ( code = 0; code < fullscale; code++ )
+	{
+		float ref = readppm( (float)code * MG811_VREF / fullscale, curve );
+		uint16_t got = codetoppm(code);
+		double err;
+
+		// outside of the table range the result saturates by design
+		if ( ref < 0 || ref > lut[lutsize - 1] || got == 0xffff )
+			continue;
+		err = fabs(got - ref) / ref;
+		if ( err > maxerr )
+		{
+			maxerr = err;
+			ppmatmax = ref;
+		}
+		n++;
+	}
+
+	t = clock();
+	for ( rep = 0; rep < 2000; rep++ )
+		for ( code = 0; code < fullscale; code++ )
+			fsink += readppm( (float)code * MG811_VREF / fullscale, curve );
+	tfloat = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+	t = clock();
+	for ( rep = 0; rep < 2000; rep++ )
+		for ( code = 0; code < fullscale; code++ )
+			isink += codetoppm(code);
+	tlut = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+	printf("table: %d entries (%d bytes), %d steps/decade, %u..%u ppm\n",
+		lutsize, lutsize * 2, steps, lut[0], lut[lutsize - 1]);
+	printf("curve: zero %u codes, scale %u\n", zero, scale);
+	printf("accuracy: %d codes in range, max relative error %.3f%% (at %.0f ppm)\n",
+		n, maxerr * 100, ppmatmax);
+	printf("speed (host): pow() %.1f ns/conversion, table %.1f ns/conversion, %.1fx\n",
+		tfloat * 1e9 / (2000.0 * fullscale), tlut * 1e9 / (2000.0 * fullscale), tfloat / tlut);
+}
+
+int main(int argc, char **argv)
+{
+	int i, docheck = 0;
+
+	for ( i = 1; i < argc; i++ )
+	{
+		if ( !strcmp(argv[i], "-c") )
+			docheck = 1;
+		else if ( !strcmp(argv[i], "-p") && i + 1 < argc )
+			ppm0 = atof(argv[++i]);
+		else if ( !strcmp(argv[i], "-s") && i + 1 < argc )
+			steps = atoi(argv[++i]);
+		else if ( !strcmp(argv[i], "-d") && i + 1 < argc )
+			decades = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: %s [-c] [-p log10(ppm0)] [-s steps] [-d decades]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	build();
+	if ( docheck )
+		check();
+	else
+		emit();
+
+	return 0;
+}
@@ -39,6 +39,9 @@
  /** Receive and Transmit actual buffer arrays **/
  int8_t UART_rxBuffer[RXBUF_SIZE] ;
  int8_t UART_txBuffer[TXBUF_SIZE] ;
+
+ /** Received bytes dropped because the buffer was full **/
+ static volatile uint8_t rxOverruns ;
  
 /**-------------------------------------------------------------------------------------------------
   Name         :  initUART
@@ -70,7 +73,7 @@ void initUART()
 	//Alternatvely: uint8_t * UART_rxBuffer = (uint8_t *) malloc(RXBUF_SIZE * sizeof(uint8_t));
 	//			    uint8_t * UART_txBuffer = (uint8_t *) malloc(TXBUF_SIZE * sizeof(uint8_t)); 
 	
-	fifoInit( rxbuf, UART_txBuffer, RXBUF_SIZE);
+	fifoInit( rxbuf, UART_rxBuffer, RXBUF_SIZE);
 	fifoInit( txbuf, UART_txBuffer, TXBUF_SIZE);
 }
 
@@ -84,11 +87,38 @@ int16_t uartSendChar(int8_t c, FILE * stream)
 {
 	if (c == '\n')
 		uartSendChar('\r', stream); // manually insert CR before LF 
+	uartSendByte(c);
+	return 0;
+}
+
+/**-------------------------------------------------------------------------------------------------
+  Name         :  uartSendByte
+  Description  :  Loads a byte to buffer as is (binary data, no LF translation)
+  Argument(s)  :  byte to send
+  Return value :  None.
+-------------------------------------------------------------------------------------------------**/
+void uartSendByte(uint8_t c)
+{
 	if ( bis(UCSRB,UDRE) && bis(SREG,7))	
 		while( fifoIsFull( txbuf ) );
 	fifoWrite(txbuf, c);
 	UCSRB |= (1<<UDRE); // enable UDRE interrupt
-	return 0;
+}
+
+/**-------------------------------------------------------------------------------------------------
+  Name         :  uartTxFree
+  Description  :  Room left in the transmit buffer, to send a block without waiting
+  Argument(s)  :  None.
+  Return value :  number of bytes that can be loaded
+-------------------------------------------------------------------------------------------------**/
+uint16_t uartTxFree(void)
+{
+	uint16_t count;
+	uint8_t sreg = SREG;
+	cli();
+	count = fifoCount(txbuf);
+	SREG = sreg;
+	return TXBUF_SIZE - 1 - count;
 }
 
 /**-------------------------------------------------------------------------------------------------
@@ -150,6 +180,37 @@ int16_t uartGet(FILE * stream)
 	return character;
 }
 
+/**-------------------------------------------------------------------------------------------------
+  Name         :  uartPoll
+  Description  :  non-blocking version of uartGet
+  Argument(s)  :  None.
+  Return value :  received character or -1 if nothing was received
+-------------------------------------------------------------------------------------------------**/
+int16_t uartPoll(void)
+{
+	int8_t character;
+	if ( fifoRead(rxbuf, &character) )
+		return -1;
+	return (uint8_t)character;
+}
+
+/**-------------------------------------------------------------------------------------------------
+  Name         :  uartOverruns
+  Description  :  number of received bytes dropped because the buffer was full, cleared on read
+  Argument(s)  :  None.
+  Return value :  dropped bytes, saturated at 255
+-------------------------------------------------------------------------------------------------**/
+uint8_t uartOverruns(void)
+{
+	uint8_t count;
+
+	UCSRB &= ~(1<<RXCIE);
+	count = rxOverruns;
+	rxOverruns = 0;
+	UCSRB |= (1<<RXCIE);
+	return count;
+}
+
 /**-------------------------------------------------------------------------------------------------
   Description         :  UDR Empty Interrupt
 -------------------------------------------------------------------------------------------------**/
@@ -167,9 +228,7 @@ ISR( USART_UDRE_vect )
 ISR(USART_RXC_vect)
 {
 	int8_t c = UDR; // read the value of the 8-bit UDR buffer
-	while ( fifoIsFull(rxbuf) )
-	 // if buffer is full, you'll lose all incoming characters. 
-	// Normally, if you just use scanf, getchar etc. they'll read the buffer for you so this is not a problem.
-		;
-	fifoWrite(rxbuf,c); // write it to our RAM buffer
+	// Nothing empties the buffer while the interrupt runs, so a byte that does not fit is dropped
+	if ( fifoWrite(rxbuf,c) && rxOverruns < 255 ) // write it to our RAM buffer
+		rxOverruns++;
 }
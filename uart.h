@@ -9,8 +9,9 @@
 #define BAUD_RATE 38400UL
 #define UBBRVAL (( F_CPU / BAUD_RATE / 16 ) - 1)
  
-// Use a size of at least 3.
-#define RXBUF_SIZE 10
+// Use a size of at least 3. The receive buffer holds a whole console line, 16 ms at 38400
+// baud, so a line pasted during an EEPROM write is not lost.
+#define RXBUF_SIZE 64
 #define TXBUF_SIZE 255
 
 /** Initialisation routines for USART module **/
@@ -19,6 +20,12 @@ void initUART(void);
 /** Function to send a char via USART **/
 int16_t uartSendChar(int8_t, FILE *);
 
+/** Function to send a byte via USART, without LF translation **/
+void uartSendByte(uint8_t);
+
+/** Free space in the transmit buffer **/
+uint16_t uartTxFree(void);
+
 /** Function to send a string via USART **/
 void uartSend(int8_t *);
 
@@ -34,5 +41,11 @@ void uartResponse(fifoType *);
 /** Receive a char routine **/
 int16_t uartGet(FILE *);
 
+/** Receive a char without waiting. Returns -1 if nothing was received. **/
+int16_t uartPoll(void);
+
+/** Received bytes dropped because the buffer was full, cleared on read **/
+uint8_t uartOverruns(void);
+
 
 #endif // header guard endif
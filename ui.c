@@ -0,0 +1,173 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	Retained dashboard. uiDraw() paints the whole layout once (labels, units, frames),
+			after that uiSet() compares the new value with the one on screen and returns at once
+			if it did not change. Changed widgets repaint only their own pixels with the
+			pixel addressed text and fill primitives, which also mark the spans dirty, so the
+			next dRefresh sends just those.
+-------------------------------------------------------------------------------------------------**/
+#include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "lph7366.h"
+#include "font.h"
+#include "ui.h"
+
+/*** Texts ***/
+static const char txtCO2[] PROGMEM = "CO2";
+static const char txtPPM[] PROGMEM = "ppm";
+static const char txtC[] PROGMEM = "C";
+static const char txtPercent[] PROGMEM = "%";
+static const char txtSoil[] PROGMEM = ICON_SPROUT;
+static const char txtLight[] PROGMEM = ICON_SUN;
+
+/*** Layout, keep in the same order as uiWidgetId_Type. The chart uses x >= 24 of banks 3..5 ***/
+static const uiWidget_Type uiLayout[UI_WIDGETS] PROGMEM = {
+	/* type			x	y	size	scale	dec	text		min	max */
+	{ UI_LABEL,		48,	0,	0,		1,		0,	txtCO2,		0,	0 },
+	{ UI_NUMBER,	0,	0,	4,		2,		0,	txtPPM,		0,	0 },
+	{ UI_NUMBER,	0,	16,	5,		1,		1,	txtC,		0,	0 },
+	{ UI_NUMBER,	36,	16,	3,		1,		0,	txtPercent,	0,	0 },
+	{ UI_ICON,		66,	16,	0,		0,		0,	NULL,		0,	0 },
+	{ UI_ICON,		75,	16,	0,		0,		0,	NULL,		0,	0 },
+	{ UI_LABEL,		0,	26,	0,		1,		0,	txtSoil,	0,	0 },
+	{ UI_BAR,		9,	26,	15,		7,		0,	NULL,		0,	2047 },
+	{ UI_LABEL,		0,	36,	0,		1,		0,	txtLight,	0,	0 },
+	{ UI_BAR,		9,	36,	15,		7,		0,	NULL,		0,	2047 },
+};
+
+// Value currently on screen
+static int16_t shown[UI_WIDGETS] = { [0 ... UI_WIDGETS - 1] = UI_NODATA };
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Prints a string from .progmem at any pixel position. Codes outside
+					of ASCII 32..126 are taken from FontIcons.
+  Return		: 	x after the text
+-------------------------------------------------------------------------------------------------**/
+static uint8_t uiText_P(uint8_t x, uint8_t y, const char * text, uint8_t scale)
+{
+	uint8_t ch;
+
+	while ( (ch = pgm_read_byte(text++)) )
+		x += ( ch < 32 || ch > 126 ) ? fontDraw(&FontIcons, scale, x, y, ch) : dCharAt(x, y, ch, scale);
+	return x;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Repaints the variable part of a widget with the value in shown[]
+-------------------------------------------------------------------------------------------------**/
+static void uiRender(uint8_t id)
+{
+	uiWidget_Type w;
+	char buf[8];
+	uint8_t i, n, neg, digits;
+	int16_t v = shown[id];
+	uint16_t u;
+
+	memcpy_P(&w, &uiLayout[id], sizeof(w));
+
+	switch ( w.type ) {
+		case UI_NUMBER:
+			// Build the digits from the right, then pad on the left to the field size
+			n = ( w.size < sizeof(buf) ) ? w.size : sizeof(buf);
+			i = n;
+			if ( v == UI_NODATA )
+			{
+				buf[--i] = '-';
+				buf[--i] = '-';
+			}
+			else
+			{
+				// At least one digit in front of the decimal point
+				neg = v < 0;
+				u = neg ? -v : v;
+				digits = w.decimals + 1;
+				while ( i && ( u || digits ) )
+				{
+					if ( w.decimals && i == n - w.decimals )
+					{
+						buf[--i] = '.';
+						continue;
+					}
+					buf[--i] = '0' + u % 10;
+					u /= 10;
+					if ( digits ) digits--;
+				}
+				if ( neg && i )
+					buf[--i] = '-';
+				else if ( neg )
+					u = 1;
+				if ( u )	// does not fit, dashes over the whole field
+					for ( i = 0; i < n; i++ ) buf[i] = '-';
+			}
+			while ( i )
+				buf[--i] = ' ';
+
+			for ( i = 0; i < n; i++ )
+				w.x += dCharAt(w.x, w.y, buf[i], w.scale);
+			break;
+
+		case UI_BAR:
+			// Frame is drawn by uiDraw, fill the inside proportionally
+			if ( v < w.min ) v = w.min;
+			if ( v > w.max ) v = w.max;
+			n = (int32_t)(v - w.min) * (w.size - 2) / (w.max - w.min);
+			if ( n )
+				dFillRect(w.x + 1, w.y + 1, w.x + n, w.y + w.scale - 2, PIXEL_ON);
+			if ( n < w.size - 2 )
+				dFillRect(w.x + 1 + n, w.y + 1, w.x + w.size - 2, w.y + w.scale - 2, PIXEL_OFF);
+			break;
+
+		case UI_ICON:
+			dFillRect(w.x + 1, w.y + 1, w.x + 5, w.y + 5, ( v && v != UI_NODATA ) ? PIXEL_ON : PIXEL_OFF);
+			break;
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Paints the complete layout with the values last passed to uiSet. Call after
+					dClear or when something else has drawn over the dashboard.
+-------------------------------------------------------------------------------------------------**/
+void uiDraw(void)
+{
+	uiWidget_Type w;
+	uint8_t id;
+
+	for ( id = 0; id < UI_WIDGETS; id++ )
+	{
+		memcpy_P(&w, &uiLayout[id], sizeof(w));
+
+		switch ( w.type ) {
+			case UI_LABEL:
+				uiText_P(w.x, w.y, w.text, w.scale);
+				break;
+
+			case UI_NUMBER:
+				// Unit after the field, aligned with the bottom of the digits
+				if ( w.text )
+					uiText_P(w.x + w.size * 6 * w.scale, w.y + 8 * (w.scale - 1), w.text, 1);
+				break;
+
+			case UI_BAR:
+				dRectangle(w.x, w.y, w.x + w.size - 1, w.y + w.scale - 1, PIXEL_ON, 1);
+				break;
+
+			case UI_ICON:
+				dRectangle(w.x, w.y, w.x + 6, w.y + 6, PIXEL_ON, 1);
+				break;
+		}
+		if ( w.type != UI_LABEL )
+			uiRender(id);
+	}
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Updates the value of a widget, repaints it only if it changed
+  Argument(s)	:	id -> uiWidgetId_Type, value -> UI_NODATA shows dashes on numbers
+-------------------------------------------------------------------------------------------------**/
+void uiSet(uint8_t id, int16_t value)
+{
+	if ( id >= UI_WIDGETS || shown[id] == value )
+		return;
+	shown[id] = value;
+	uiRender(id);
+}
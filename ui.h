@@ -0,0 +1,46 @@
+#ifndef UI_H
+#define UI_H
+
+#include <stdint.h>
+
+/* Retained dashboard on the LCD. The widgets are described by the PROGMEM layout in ui.c,
+   each remembers the value it shows and is only redrawn when uiSet() gets a different one. */
+
+// Value shown as dashes (sensor not ready, invalid reading)
+#define UI_NODATA		INT16_MIN
+
+typedef enum {
+	UI_LABEL,						// constant text
+	UI_NUMBER,						// right aligned value with optional decimal point and unit
+	UI_BAR,							// horizontal gauge between min and max
+	UI_ICON							// relay state, filled box when the value is not 0
+} uiType_Type;
+
+typedef struct {
+	uint8_t type;					// uiType_Type
+	uint8_t x, y;					// top left pixel
+	uint8_t size;					// NUMBER: characters, BAR: width in pixels
+	uint8_t scale;					// NUMBER: font scale 1..3, BAR: height in pixels
+	uint8_t decimals;				// NUMBER: digits after the decimal point, 0 or 1
+	const char * text;				// LABEL: text, NUMBER: unit, in .progmem (may be NULL)
+	int16_t min, max;				// BAR: value range
+} uiWidget_Type;
+
+typedef enum {
+	UI_CO2_LABEL,
+	UI_CO2,							// ppm
+	UI_TEMPERATURE,					// 0.1 C
+	UI_HUMIDITY,					// %RH
+	UI_RELAY1,
+	UI_RELAY2,
+	UI_SOIL_LABEL,
+	UI_SOIL,						// ADC code
+	UI_LIGHT_LABEL,
+	UI_LIGHT,						// ADC code
+	UI_WIDGETS
+} uiWidgetId_Type;
+
+void uiDraw(void);
+void uiSet(uint8_t id, int16_t value);
+
+#endif
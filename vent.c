@@ -0,0 +1,189 @@
+/**------------------------------------------------------------------------------------------------
+  Note : 	CO2 vent controller. ventTick() reads the filtered MG811 concentration once a second
+			and picks the source of the duty cycle: the ceiling forces the vent on at once,
+			without waiting for the cycle or the integral; a sensor in warm-up gives the
+			fallback duty; otherwise the PI controller runs. A reading below the 400 ppm point
+			(MG811_PPM_INVALID) is fresh air and counts as 400 ppm. Leaving the ceiling presets
+			the integral to full vent so the controller takes over without a step.
+-------------------------------------------------------------------------------------------------**/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "nvm.h"
+#include "relay.h"
+#include "console.h"
+#include "mg811.h"
+#include "mg811cal.h"
+#include "pid.h"
+#include "vent.h"
+
+static ventSettings_Type settings = {
+	1, VENT_SETPOINT, VENT_CEILING, VENT_KP, VENT_KI, VENT_CYCLE
+};
+
+static ventStatus_Type status;
+static pid_Type pid;
+static tpo_Type tpo;
+
+// Request of the controller, and of the ceiling that wins over manual control
+static void ventRelay(uint8_t on, uint8_t forced)
+{
+	relayRequest(RELAY_VENT, RELAY_AUTO, on ? RELAY_ON : RELAY_OFF);
+	relayRequest(RELAY_VENT, RELAY_SAFETY, forced ? RELAY_ON : RELAY_RELEASE);
+}
+
+// Applies the settings to the controller, keeps its integral
+static void ventApply(void)
+{
+	pid.kp = settings.kp;
+	pid.ki = settings.ki;
+	tpoInit(&tpo, settings.cycle, VENT_MIN_PULSE);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Loads the settings and stops the vent
+-------------------------------------------------------------------------------------------------**/
+void ventInit(void)
+{
+	ventSettings_Type record;
+
+	if ( nvmLoad(NVM_VENT, &record, sizeof(record), VENT_VERSION) && record.cycle )
+		settings = record;
+
+	ventRelay(0, 0);
+	pidInit(&pid, settings.kp, settings.ki, VENT_DUTY_MAX);
+	ventApply();
+	status.setpoint = settings.setpoint;
+	status.state = VENT_DISABLED;
+}
+
+static void ventSave(void)
+{
+	nvmSave(NVM_VENT, &settings, sizeof(settings), VENT_VERSION);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Runs the controller. Call once per second, after MG811_Update().
+-------------------------------------------------------------------------------------------------**/
+void ventTick(void)
+{
+	uint16_t ppm = MG811_ReadPPM();
+
+	if ( ppm == MG811_PPM_INVALID )
+		ppm = 400;
+	status.ppm = ppm;
+	status.relay = relayState(RELAY_VENT);
+
+	if ( !settings.enabled )
+	{
+		status.state = VENT_DISABLED;
+		status.duty = 0;
+		pidPreset(&pid, 0);
+		tpoRestart(&tpo);
+		ventRelay(0, 0);
+		return;
+	}
+
+	if ( ppm >= settings.ceiling || 
+		( status.state == VENT_CEILING_FORCED && ppm + VENT_CEILING_HYST > settings.ceiling ) )
+	{
+		status.state = VENT_CEILING_FORCED;
+		status.duty = VENT_DUTY_MAX;
+		pidPreset(&pid, VENT_DUTY_MAX);
+		tpoRestart(&tpo);
+		ventRelay(1, 1);
+		return;
+	}
+
+	if ( MG811_CalState() == MG811_WARMUP )
+	{
+		status.state = VENT_FALLBACK;
+		status.duty = VENT_FALLBACK_DUTY;
+	}
+	else
+	{
+		status.state = VENT_PI;
+		status.duty = pidStep(&pid, (int16_t)(ppm - status.setpoint));
+	}
+	ventRelay(tpoStep(&tpo, status.duty, VENT_DUTY_MAX), 0);
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Enables or disables the control and saves it
+-------------------------------------------------------------------------------------------------**/
+void ventEnable(uint8_t on)
+{
+	settings.enabled = on;
+	ventSave();
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Changes the setpoint in use, for the schedule. The saved one is left alone.
+  Argument(s)	:	setpoint -> ppm
+-------------------------------------------------------------------------------------------------**/
+void ventTarget(uint16_t setpoint)
+{
+	status.setpoint = setpoint;
+}
+
+const ventStatus_Type * ventStatus(void)
+{
+	return &status;
+}
+
+/**------------------------------------------------------------------------------------------------
+  Description 	: 	Console command
+					vent					- show the settings and the state
+					vent on|off				- enable or disable the control
+					vent set <ppm> [ceiling]	- setpoint and ceiling
+					vent gain <kp> <ki>		- gains, see VENT_KP and VENT_KI
+					vent cycle <s>			- time proportioning period
+					vent default			- restore the compile time settings
+-------------------------------------------------------------------------------------------------**/
+void ventCommand(char * args)
+{
+	char * value = consoleNextArg(args);
+	char * value2 = consoleNextArg(value);
+
+	if ( !strcmp_P(args, PSTR("on")) )
+		settings.enabled = 1;
+	else if ( !strcmp_P(args, PSTR("off")) )
+		settings.enabled = 0;
+	else if ( !strcmp_P(args, PSTR("set")) && atoi(value) >= 400 )
+	{
+		settings.setpoint = atoi(value);
+		status.setpoint = settings.setpoint;
+		if ( *value2 )
+			settings.ceiling = atoi(value2);
+	}
+	else if ( !strcmp_P(args, PSTR("gain")) && *value2 )
+	{
+		settings.kp = atoi(value);
+		settings.ki = atoi(value2);
+	}
+	else if ( !strcmp_P(args, PSTR("cycle")) && atoi(value) > 2 * VENT_MIN_PULSE )
+		settings.cycle = atoi(value);
+	else if ( !strcmp_P(args, PSTR("default")) )
+	{
+		settings.setpoint = VENT_SETPOINT;
+		status.setpoint = settings.setpoint;
+		settings.ceiling = VENT_CEILING;
+		settings.kp = VENT_KP;
+		settings.ki = VENT_KI;
+		settings.cycle = VENT_CYCLE;
+	}
+
+	if ( *args )
+	{
+		ventApply();
+		ventSave();
+	}
+
+	printf_P(PSTR("\nVENT: %S sp %u ceiling %u kp %d ki %d cycle %u s"), 
+		settings.enabled ? PSTR("on") : PSTR("off"), 
+		settings.setpoint, settings.ceiling, settings.kp, settings.ki, settings.cycle);
+	printf_P(PSTR("\nVENT: state %u relay %u ppm %u duty %u sp now %u"), 
+		status.state, status.relay, status.ppm, status.duty, status.setpoint);
+}
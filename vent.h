@@ -0,0 +1,60 @@
+#ifndef VENT_H
+#define VENT_H
+
+#include <stdint.h>
+
+/* CO2 control with the vent relay (RELAY_VENT). A PI controller (pid.h) turns the distance
+   of the MG811 reading above the setpoint into a duty cycle, and the relay is switched on for
+   that part of every cycle. Above the ceiling the vent runs continuously, over a manual
+   override too, until the CO2 drops VENT_CEILING_HYST below it. While the sensor warms up
+   the duty is VENT_FALLBACK_DUTY. ventTick() is called once a second. */
+
+// Duty cycle full scale, permille
+#define VENT_DUTY_MAX		1000
+
+// Compile time defaults of the settings, tuned with tools/co2sim
+#define VENT_SETPOINT		1000	// ppm
+#define VENT_CEILING		2500	// ppm
+#define VENT_KP				4096	// permille per ppm, / 2^PID_SHIFT (1 permille per ppm)
+#define VENT_KI				8		// permille per ppm and second, / 2^PID_SHIFT
+#define VENT_CYCLE			120		// s
+
+#define VENT_CEILING_HYST	200		// ppm
+#define VENT_MIN_PULSE		10		// s, shorter on or off times are skipped
+#define VENT_FALLBACK_DUTY	250		// permille, sensor warming up
+
+// Increment when the layout of ventSettings_Type changes
+#define VENT_VERSION		1
+
+typedef struct {
+	uint8_t enabled;
+	uint16_t setpoint;				// ppm
+	uint16_t ceiling;				// ppm
+	int16_t kp;						// see VENT_KP
+	int16_t ki;						// see VENT_KI
+	uint16_t cycle;					// s
+} ventSettings_Type;
+
+typedef enum {
+	VENT_DISABLED,					// relay off
+	VENT_PI,						// duty from the controller
+	VENT_CEILING_FORCED,			// relay on, CO2 above the ceiling
+	VENT_FALLBACK					// fixed duty, no usable reading
+} ventState_Type;
+
+typedef struct {
+	uint8_t state;					// ventState_Type
+	uint8_t relay;					// vent state at the last tick, whoever asked for it
+	uint16_t ppm;					// reading used by the last tick
+	uint16_t duty;					// permille
+	uint16_t setpoint;				// in use: the saved one, or the schedule's until the next "vent set"
+} ventStatus_Type;
+
+void ventInit(void);
+void ventTick(void);
+void ventEnable(uint8_t on);
+void ventTarget(uint16_t setpoint);
+const ventStatus_Type * ventStatus(void);
+void ventCommand(char * args);
+
+#endif